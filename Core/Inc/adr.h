@@ -0,0 +1,116 @@
+#ifndef ADR_H
+#define ADR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sx1272.h"
+
+/*
+ * Adaptive data rate and transmit power control.
+ *
+ * The link margin of every peer (packet SNR above the demodulation floor
+ * of the current spreading factor) is averaged over received frames. Below
+ * ADR_MARGIN_LOW_DB the link is made more robust: power first, then
+ * spreading factor, then coding rate. Above ADR_MARGIN_HIGH_DB the steps
+ * are undone in reverse order, so airtime drops before power does. The gap
+ * between the thresholds is the hysteresis and is wider than any single
+ * step, so a change never immediately triggers the opposite one.
+ *
+ * Both ends must use the same parameters, so a change is agreed with a
+ * control frame: the node that measured the margin sends ADR_CMD_REQUEST,
+ * the peer answers ADR_CMD_ACCEPT and both switch. If the peer is not
+ * heard with the new parameters within ADR_REVERT_MS it falls back.
+ */
+
+#define ADR_MAX_PEERS        8
+#define ADR_MIN_SAMPLES      8       // Frames averaged before a decision
+#define ADR_MARGIN_LOW_DB    3
+#define ADR_MARGIN_HIGH_DB   10
+#define ADR_POWER_STEP_DB    3
+#define ADR_REQUEST_MS       5000    // Request retried after this long
+#define ADR_REVERT_MS        30000
+
+// Control frame payload: | command | sf | cr | power |
+#define ADR_CMD_REQUEST      0x01
+#define ADR_CMD_ACCEPT       0x02
+#define ADR_PAYLOAD_SIZE     4
+
+typedef struct {
+    bool     used;
+    uint8_t  peer;
+    uint8_t  samples;
+    int16_t  margin_q4;            // Averaged margin in 1/16 dB
+    int16_t  rssi;                 // Last packet RSSI in dBm
+    SX1272_ModemParams_t params;   // Agreed parameters
+    SX1272_ModemParams_t previous; // Restored if the peer goes silent after a change
+    bool     requested;            // Our request is waiting for ADR_CMD_ACCEPT
+    bool     probation;            // New parameters not yet confirmed by a frame
+    uint32_t since;                // Time of the request or switch
+} adr_link_t;
+
+/**
+ * @brief Forgets all peers.
+ *
+ * @param initial Parameters every link starts with.
+ */
+void adr_init(const SX1272_ModemParams_t *initial);
+
+/**
+ * @brief Adds an authenticated packet from a peer to its margin average.
+ *
+ * Also ends the probation of freshly switched parameters.
+ *
+ * @param peer Source address.
+ * @param snr  Packet SNR in dB.
+ * @param rssi Packet RSSI in dBm.
+ */
+void adr_record(uint8_t peer, int8_t snr, int16_t rssi);
+
+/**
+ * @brief Decides whether the link to a peer should change.
+ *
+ * @param peer     Peer address.
+ * @param now      Current time in milliseconds.
+ * @param proposal Output: parameters to request.
+ * @return true    If proposal should be sent as ADR_CMD_REQUEST.
+ */
+bool adr_evaluate(uint8_t peer, uint32_t now, SX1272_ModemParams_t *proposal);
+
+/**
+ * @brief Handles a control payload from a peer.
+ *
+ * @param peer    Source address.
+ * @param payload Control payload.
+ * @param len     Payload length.
+ * @param now     Current time in milliseconds.
+ * @param apply   Output: parameters to switch to, valid if true is returned.
+ * @param reply   Output: ADR_CMD_ACCEPT to send back, or 0 for none.
+ * @return true   If the radio must switch to apply.
+ */
+bool adr_handle_control(uint8_t peer, const uint8_t *payload, uint8_t len, uint32_t now,
+                        SX1272_ModemParams_t *apply, uint8_t *reply);
+
+/**
+ * @brief Writes a control payload.
+ *
+ * @param command ADR_CMD_REQUEST or ADR_CMD_ACCEPT.
+ * @param params  Parameters to carry.
+ * @param payload Output: ADR_PAYLOAD_SIZE bytes.
+ */
+void adr_encode(uint8_t command, const SX1272_ModemParams_t *params, uint8_t *payload);
+
+/**
+ * @brief Reverts links whose peer stayed silent after a switch.
+ *
+ * @param now    Current time in milliseconds.
+ * @param revert Output: parameters to switch back to, valid if true is returned.
+ * @return true  If the radio must switch back.
+ */
+bool adr_tick(uint32_t now, SX1272_ModemParams_t *revert);
+
+/**
+ * @brief Returns the link state of a peer, or NULL if it was never heard.
+ */
+const adr_link_t *adr_get_link(uint8_t peer);
+
+#endif /* ADR_H */
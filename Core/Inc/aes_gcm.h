@@ -13,6 +13,17 @@
 // GCM authentication tag size (128 bits = 16 bytes)
 #define GCM_TAG_SIZE 16
 
+/**
+ * @brief Precomputed per-key state.
+ *
+ * Holds the key and the GHASH subkey H so that per-message calls skip the
+ * key setup. Fill it with aes_gcm_setkey().
+ */
+typedef struct {
+    uint8_t key[AES_KEY_SIZE];
+    uint8_t h[16];
+} aes_gcm_ctx_t;
+
 /**
  * @brief Initializes the AES-GCM module.
  * 
@@ -57,4 +68,43 @@ bool aes_gcm_decrypt(const uint8_t *key, const uint8_t *nonce,
                      const uint8_t *aad, uint32_t aad_len,
                      const uint8_t *tag, uint8_t *plaintext);
 
+/**
+ * @brief Encrypts a single 16-byte block with the raw block cipher.
+ * 
+ * Exposed for key derivation (AES-CMAC); messages should use the GCM calls.
+ * 
+ * @param key         128-bit AES key (16 bytes).
+ * @param in          Input block (16 bytes).
+ * @param out         Output block (16 bytes), may equal in.
+ */
+void aes_gcm_block_encrypt(const uint8_t *key, const uint8_t *in, uint8_t *out);
+
+/**
+ * @brief Prepares a context for a key.
+ * 
+ * @param ctx         Context to fill.
+ * @param key         128-bit AES key (16 bytes).
+ */
+void aes_gcm_setkey(aes_gcm_ctx_t *ctx, const uint8_t *key);
+
+/**
+ * @brief Encrypts plaintext using a context prepared by aes_gcm_setkey().
+ * 
+ * Parameters and result are the same as aes_gcm_encrypt().
+ */
+bool aes_gcm_encrypt_ctx(const aes_gcm_ctx_t *ctx, const uint8_t *nonce,
+                         const uint8_t *plaintext, uint32_t plaintext_len,
+                         const uint8_t *aad, uint32_t aad_len,
+                         uint8_t *ciphertext, uint8_t *tag);
+
+/**
+ * @brief Decrypts and verifies using a context prepared by aes_gcm_setkey().
+ * 
+ * Parameters and result are the same as aes_gcm_decrypt().
+ */
+bool aes_gcm_decrypt_ctx(const aes_gcm_ctx_t *ctx, const uint8_t *nonce,
+                         const uint8_t *ciphertext, uint32_t ciphertext_len,
+                         const uint8_t *aad, uint32_t aad_len,
+                         const uint8_t *tag, uint8_t *plaintext);
+
 #endif /* AES_GCM_H */
\ No newline at end of file
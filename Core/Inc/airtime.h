@@ -0,0 +1,41 @@
+#ifndef AIRTIME_H
+#define AIRTIME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief LoRa packet parameters that determine the time on air.
+ */
+typedef struct {
+    uint8_t  sf;               // Spreading factor 6..12
+    uint32_t bw_hz;            // Bandwidth, e.g. 125000
+    uint8_t  cr;               // Coding rate 4/(4+cr), 1..4
+    uint16_t preamble;         // Programmed preamble length in symbols
+    bool     implicit_header;
+    bool     crc;
+    bool     ldro;             // Low data rate optimisation
+} airtime_params_t;
+
+/**
+ * @brief Number of symbols in the packet, preamble included, in quarter symbols.
+ *
+ * The preamble adds 4.25 symbols of sync word and SFD to the programmed
+ * length, hence the quarter-symbol unit.
+ *
+ * @param params      Modulation and packet format.
+ * @param payload_len Payload length in bytes.
+ * @return uint32_t   Packet length in quarter symbols.
+ */
+uint32_t airtime_symbols_q4(const airtime_params_t *params, uint8_t payload_len);
+
+/**
+ * @brief Exact time on air of a packet (SX1272 datasheet, section 4.1.1.7).
+ *
+ * @param params      Modulation and packet format.
+ * @param payload_len Payload length in bytes.
+ * @return uint32_t   Time on air in microseconds, rounded up.
+ */
+uint32_t airtime_us(const airtime_params_t *params, uint8_t payload_len);
+
+#endif /* AIRTIME_H */
@@ -0,0 +1,123 @@
+#ifndef ARQ_H
+#define ARQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lora_frame.h"
+
+/*
+ * Selective-repeat ARQ for the link to one peer.
+ *
+ * Reliable frames (FRAME_TYPE_ARQ) start their payload with
+ *
+ *   | seq | base | ack | ack bitmap (2, BE) | data |
+ *
+ * and ack-only frames (FRAME_TYPE_ARQ_ACK) carry | base | ack | bitmap |.
+ * ack is the first sequence number not yet received, so everything before
+ * it is acknowledged at once; bit i of the bitmap acknowledges ack + 1 + i
+ * received out of order. Every reliable frame carries the current
+ * acknowledgement of the reverse direction. An ack-only frame goes out
+ * only when no reliable frame picked it up within ARQ_ACK_DELAY_MS.
+ *
+ * Up to the configured window of frames may be unacknowledged. Each one
+ * has a retransmission timer on a timer wheel; only the frames whose timer
+ * fires are sent again, and are resealed then with a new counter and fresh
+ * acknowledgement. The timeout follows the smoothed round-trip time and
+ * its variance (RFC 6298), with samples taken only from frames sent once,
+ * and doubles with each retransmission of a frame. A frame is given up
+ * after ARQ_RETRY_MAX retransmissions.
+ *
+ * base is the oldest frame the sender still retransmits. The receiver
+ * skips anything before it that never arrived, so a frame given up leaves
+ * a gap instead of stalling the link. A base far outside the receive
+ * window means the peer restarted; the receiver then resynchronises on it.
+ * Frames are handed to the application in sequence.
+ */
+
+#define ARQ_WINDOW_MAX       16      // Bits of the ack bitmap
+#define ARQ_PAYLOAD_MAX      96      // Frame fits a 128-byte split-FIFO region
+#define ARQ_HEADER_SIZE      5
+#define ARQ_ACK_SIZE         4
+#define ARQ_RETRY_MAX        6
+
+#define ARQ_TICK_MS          50      // Timer wheel resolution
+#define ARQ_ACK_DELAY_MS     250     // Wait for reverse traffic to carry an ack
+#define ARQ_RTO_INIT_MS      3000
+#define ARQ_RTO_MIN_MS       1000    // Above the SF7 round trip of a full frame
+#define ARQ_RTO_MAX_MS       60000
+
+typedef struct {
+    uint32_t sent;               // Reliable frames sent for the first time
+    uint32_t retransmitted;
+    uint32_t acked;
+    uint32_t failed;             // Given up after ARQ_RETRY_MAX
+    uint32_t received;           // New reliable frames
+    uint32_t duplicates;
+    uint32_t acks_sent;          // Ack-only frames
+    uint32_t skipped;            // Receiver: frames the sender gave up
+    uint32_t resyncs;
+    uint32_t srtt_ms;
+    uint32_t rto_ms;
+} arq_stats_t;
+
+/**
+ * @brief Resets both directions.
+ *
+ * @param frames Send window: frames in flight, 1..ARQ_WINDOW_MAX.
+ * @param now    Current time in ms.
+ */
+void arq_init(uint8_t frames, uint32_t now);
+
+/**
+ * @brief Queues data for reliable delivery.
+ *
+ * @return bool False if the window is full or len exceeds ARQ_PAYLOAD_MAX.
+ */
+bool arq_send(const uint8_t *data, uint8_t len);
+
+/**
+ * @brief Returns the number of frames that may still be queued.
+ */
+uint8_t arq_window_free(void);
+
+/**
+ * @brief Builds the next frame to hand to the radio.
+ *
+ * Frames go out oldest first, retransmissions before new ones since they
+ * are older; an ack-only frame is built when one is due and nothing else is.
+ * The payload is sealed by the caller right away, so the acknowledgement
+ * it carries is current.
+ *
+ * @param type     Output: FRAME_TYPE_ARQ or FRAME_TYPE_ARQ_ACK.
+ * @param payload  Output buffer, ARQ_HEADER_SIZE + ARQ_PAYLOAD_MAX bytes.
+ * @param now      Current time in ms.
+ * @return uint8_t Payload length, or 0 if nothing is due.
+ */
+uint8_t arq_next(uint8_t *type, uint8_t *payload, uint32_t now);
+
+/**
+ * @brief Processes an authenticated FRAME_TYPE_ARQ or FRAME_TYPE_ARQ_ACK payload.
+ */
+void arq_on_frame(uint8_t type, const uint8_t *payload, uint8_t len, uint32_t now);
+
+/**
+ * @brief Runs expired retransmission and ack timers.
+ */
+void arq_tick(uint32_t now);
+
+/**
+ * @brief Returns the next frame in sequence without removing it.
+ *
+ * @param len Output: data length.
+ * @return const uint8_t* Data, or NULL if the next frame has not arrived.
+ */
+const uint8_t *arq_peek(uint8_t *len);
+
+/**
+ * @brief Frees the frame returned by arq_peek().
+ */
+void arq_release(void);
+
+const arq_stats_t *arq_get_stats(void);
+
+#endif /* ARQ_H */
@@ -0,0 +1,44 @@
+#ifndef CHANNEL_PLAN_H
+#define CHANNEL_PLAN_H
+
+#include <stdint.h>
+
+/*
+ * EU868 channel plan for frequency hopping.
+ *
+ * The FRF register values of every channel are computed by the compiler,
+ * so a hop is one 3-byte burst with no runtime division. All nodes of a
+ * network derive the same hop sequence from the network seed.
+ */
+
+#define CHANNEL_COUNT     8
+
+// FRF = f * 2^19 / F_XOSC with the 32 MHz crystal
+#define CHANNEL_FRF(hz)   ((uint32_t)(((uint64_t)(hz) << 19) / 32000000ULL))
+
+/**
+ * @brief Builds the hop sequence of a network.
+ *
+ * @param seed Network seed; nodes with the same seed hop identically.
+ */
+void channel_plan_init(uint32_t seed);
+
+/**
+ * @brief Channel used in a hop slot.
+ *
+ * @param hop Hop counter, the sequence repeats every CHANNEL_COUNT hops.
+ * @return uint8_t Channel index 0..CHANNEL_COUNT-1.
+ */
+uint8_t channel_plan_hop(uint32_t hop);
+
+/**
+ * @brief FRF_MSB/MID/LSB register values of a channel.
+ */
+const uint8_t *channel_plan_frf(uint8_t channel);
+
+/**
+ * @brief Centre frequency of a channel in Hz.
+ */
+uint32_t channel_plan_freq(uint8_t channel);
+
+#endif /* CHANNEL_PLAN_H */
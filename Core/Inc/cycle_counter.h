@@ -0,0 +1,32 @@
+#ifndef CYCLE_COUNTER_H
+#define CYCLE_COUNTER_H
+
+#include "stm32g4xx.h"
+#include <stdint.h>
+
+/**
+ * @brief Enables the DWT cycle counter (CPU clock resolution) and resets it.
+ */
+static inline void cycle_counter_init(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * @brief Returns the current cycle count; wraps every 2^32 cycles.
+ */
+static inline uint32_t cycle_counter_read(void) {
+    return DWT->CYCCNT;
+}
+
+/**
+ * @brief Converts a cycle count difference to microseconds.
+ *
+ * Differences stay valid up to 2^32 cycles (25 s at 168 MHz).
+ */
+static inline uint32_t cycle_counter_to_us(uint32_t cycles) {
+    return cycles / (SystemCoreClock / 1000000U);
+}
+
+#endif /* CYCLE_COUNTER_H */
@@ -0,0 +1,71 @@
+#ifndef DUTY_H
+#define DUTY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * EU868 duty-cycle ledger (ETSI EN 300 220, ERC REC 70-03 annex 1).
+ *
+ * Airtime is booked per sub-band into DUTY_SLOTS + 1 buckets of
+ * DUTY_SLOT_MS. A transmission is allowed only if the buckets, which
+ * together cover at least the last hour, plus the new frame stay within the
+ * sub-band's hourly budget, so the limit holds for every one-hour window.
+ */
+
+#define DUTY_WINDOW_MS   3600000UL
+#define DUTY_SLOTS       24
+#define DUTY_SLOT_MS     (DUTY_WINDOW_MS / DUTY_SLOTS)
+
+typedef struct {
+    uint32_t lo_hz;
+    uint32_t hi_hz;
+    uint16_t divisor;     // Duty cycle 1/divisor: 100 = 1 %, 1000 = 0.1 %
+} duty_band_t;
+
+/**
+ * @brief Clears the ledger.
+ *
+ * @param now Current time in milliseconds.
+ */
+void duty_init(uint32_t now);
+
+/**
+ * @brief Returns the sub-band a channel belongs to.
+ *
+ * @param freq_hz Channel centre frequency.
+ * @param bw_hz   Channel bandwidth; the whole channel must lie inside the band.
+ * @return const duty_band_t* Sub-band, or NULL if transmitting there is not allowed.
+ */
+const duty_band_t *duty_band(uint32_t freq_hz, uint32_t bw_hz);
+
+/**
+ * @brief Checks whether a frame may be sent now.
+ *
+ * @param freq_hz    Channel centre frequency.
+ * @param bw_hz      Channel bandwidth.
+ * @param airtime_us Time on air of the frame.
+ * @param now        Current time in milliseconds.
+ * @return true      If the sub-band budget has room for the frame.
+ */
+bool duty_allows(uint32_t freq_hz, uint32_t bw_hz, uint32_t airtime_us, uint32_t now);
+
+/**
+ * @brief Books a transmission against its sub-band.
+ */
+void duty_record(uint32_t freq_hz, uint32_t bw_hz, uint32_t airtime_us, uint32_t now);
+
+/**
+ * @brief Time until the oldest bucket expires and budget may free up.
+ *
+ * @param now Current time in milliseconds.
+ * @return uint32_t Milliseconds until the next slot boundary.
+ */
+uint32_t duty_next_change(uint32_t now);
+
+/**
+ * @brief Airtime booked in the current window of a sub-band, in microseconds.
+ */
+uint32_t duty_used_us(const duty_band_t *band, uint32_t now);
+
+#endif /* DUTY_H */
@@ -0,0 +1,187 @@
+#ifndef FRAG_H
+#define FRAG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lora_frame.h"
+
+/*
+ * Fragmentation of messages longer than one frame.
+ *
+ * The sender encrypts the whole message once under the nonce of one frame
+ * counter, appends a single GCM tag and cuts ciphertext and tag into
+ * FRAME_TYPE_FRAGMENT frames. Every fragment repeats the frame header with
+ * that counter, which names the message, and adds
+ *
+ *   | index | count | chunk | data |
+ *
+ * where fragment index holds bytes index * chunk onwards of the
+ * ciphertext-and-tag stream. Fragments carry no tag of their own; the AAD
+ * of the message is the frame header followed by count and chunk, and is
+ * checked once the last missing fragment has arrived.
+ *
+ * The receiver collects fragments in a pool of FRAG_RX_SLOTS buffers. When
+ * the final fragment arrives with gaps, when a fragment arrives twice or
+ * when a message stalls for FRAG_STATUS_MS, it answers with a status frame
+ * listing the missing fragments, and the sender repeats only those. A
+ * status with no fragments missing acknowledges the message. A sender that
+ * hears nothing for FRAG_TX_POLL_MS repeats the last fragment to ask for one.
+ *
+ * Fragments are checked against a replay window of their own, which only
+ * holds message counters, so repeats of a message are accepted however
+ * many other frames the peer sends meanwhile.
+ *
+ * Time comes from frag_tick(); events in between are stamped with the time
+ * of the last call.
+ */
+
+#define FRAG_MAX_FRAGMENTS   32                       // Bits of the missing-fragment bitmap
+#define FRAG_MESSAGE_MAX     1024                     // Plaintext bytes per message
+#define FRAG_BUFFER_SIZE     (FRAG_MESSAGE_MAX + GCM_TAG_SIZE)
+#define FRAG_RX_SLOTS        2
+#define FRAG_HEADER_SIZE     3
+#define FRAG_CHUNK_MIN       16
+#define FRAG_FRAME_MIN       (FRAME_HEADER_SIZE + FRAG_HEADER_SIZE + 1)
+
+#define FRAG_STATUS_MS       3000    // Receiver: stall before asking for the gaps
+#define FRAG_RX_TIMEOUT_MS   20000   // Receiver: stall before the slot is dropped
+#define FRAG_TX_POLL_MS      6000    // Sender: silence before the last fragment is repeated
+#define FRAG_TX_ROUNDS       8       // Sender: repeat rounds before the message is given up
+
+// Status payload (FRAME_TYPE_FRAG_STATUS): | counter (4, BE) | missing bitmap (4, BE) |
+#define FRAG_STATUS_SIZE     8
+
+typedef enum {
+    FRAG_TX_IDLE = 0,
+    FRAG_TX_SENDING,     // Fragments pending
+    FRAG_TX_WAITING,     // All sent, waiting for a status
+    FRAG_TX_DONE,        // Acknowledged
+    FRAG_TX_FAILED       // Out of repeat rounds
+} frag_tx_state_t;
+
+typedef struct {
+    uint32_t tx_messages;
+    uint32_t tx_fragments;    // Fragment frames handed out, repeats included
+    uint32_t tx_repeats;
+    uint32_t tx_failed;
+    uint32_t rx_fragments;
+    uint32_t rx_messages;     // Authenticated
+    uint32_t rx_duplicates;
+    uint32_t rx_dropped;      // No free slot, malformed or timed out
+    uint32_t rx_auth_failed;
+} frag_stats_t;
+
+/**
+ * @brief Clears sender, receive pool and counters.
+ */
+void frag_init(void);
+
+/**
+ * @brief Advances the module clock and runs the timeouts of both sides.
+ *
+ * @param now Current time in ms (HAL tick).
+ */
+void frag_tick(uint32_t now);
+
+/**
+ * @brief Encrypts a message and prepares its fragments.
+ *
+ * Only one message is in flight at a time; starting a new one abandons the
+ * previous one, so check frag_tx_busy() first.
+ *
+ * @param ctx       AEAD context of the key named in header->key_hint.
+ * @param header    Header of the fragments; counter must come from
+ *                  nonce_generate(), type is set to FRAME_TYPE_FRAGMENT.
+ * @param message   Plaintext.
+ * @param length    Length of message, at most FRAG_MESSAGE_MAX.
+ * @param max_frame Largest frame to send, header included.
+ * @return uint8_t  Number of fragments, or 0 if the message does not fit.
+ */
+uint8_t frag_tx_start(const aes_gcm_ctx_t *ctx, const lora_frame_header_t *header,
+                      const uint8_t *message, uint16_t length, uint8_t max_frame);
+
+/**
+ * @brief Writes the next pending fragment.
+ *
+ * @param frame    Output buffer, at least max_frame bytes.
+ * @return uint8_t Frame length, or 0 if nothing is pending.
+ */
+uint8_t frag_tx_next(uint8_t *frame);
+
+/**
+ * @brief Applies a status frame from the receiver.
+ *
+ * Missing fragments become pending again; an empty bitmap completes the
+ * message.
+ *
+ * @param payload Authenticated FRAME_TYPE_FRAG_STATUS payload.
+ * @param len     Payload length.
+ */
+void frag_tx_status(const uint8_t *payload, uint8_t len);
+
+/**
+ * @brief Returns the state of the message in flight.
+ */
+frag_tx_state_t frag_tx_state(void);
+
+/**
+ * @brief Returns true while a message is still sending or waiting for its status.
+ */
+bool frag_tx_busy(void);
+
+/**
+ * @brief Stores a fragment that passed the network, address, key and replay stages.
+ *
+ * @param header    Parsed frame header.
+ * @param frame     Raw fragment frame.
+ * @param frame_len Length of the raw frame.
+ * @return bool     True if this fragment completed its message; call
+ *                  frag_rx_open() next.
+ */
+bool frag_rx_add(const lora_frame_header_t *header, const uint8_t *frame, uint8_t frame_len);
+
+/**
+ * @brief Authenticates and decrypts the message completed by frag_rx_add().
+ *
+ * On failure the slot is freed; on success the plaintext stays in the slot
+ * until frag_rx_release().
+ *
+ * @param ctx    Context of the key that accepted the fragments.
+ * @param header Header of the completing fragment.
+ * @return bool  True if the tag verified.
+ */
+bool frag_rx_open(const aes_gcm_ctx_t *ctx, const lora_frame_header_t *header);
+
+/**
+ * @brief Returns the plaintext of an authenticated message.
+ *
+ * @param header Header of any fragment of the message.
+ * @param length Output: message length.
+ * @return const uint8_t* Plaintext, or NULL if no such message is held.
+ */
+const uint8_t *frag_rx_message(const lora_frame_header_t *header, uint16_t *length);
+
+/**
+ * @brief Frees the slot of a message once the application is done with it.
+ */
+void frag_rx_release(const lora_frame_header_t *header);
+
+/**
+ * @brief A fragment of an already completed message came in again.
+ *
+ * The sender missed our acknowledgement; it is repeated.
+ */
+void frag_rx_replayed(const lora_frame_header_t *header);
+
+/**
+ * @brief Takes the next status frame the receiver owes a sender.
+ *
+ * @param peer     Output: address of the sender.
+ * @param payload  Output buffer, FRAG_STATUS_SIZE bytes.
+ * @return bool    False if no status is due.
+ */
+bool frag_rx_status(uint8_t *peer, uint8_t *payload);
+
+const frag_stats_t *frag_get_stats(void);
+
+#endif /* FRAG_H */
@@ -0,0 +1,70 @@
+#ifndef KDF_H
+#define KDF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "aes_gcm.h"
+
+// Number of expanded epoch contexts kept in the LRU cache
+#define KDF_CACHE_SIZE 4
+
+/**
+ * @brief Cache counters.
+ *
+ * Prefetches are counted separately so that hits/misses only reflect
+ * lookups made on the packet path.
+ */
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t prefetches;
+} kdf_stats_t;
+
+/**
+ * @brief Loads the master key and empties the cache.
+ *
+ * The CMAC subkeys of the master key are computed here once.
+ *
+ * @param master_key 128-bit master key (16 bytes).
+ * @param label      Purpose label mixed into every derivation.
+ */
+void kdf_init(const uint8_t *master_key, uint8_t label);
+
+/**
+ * @brief Derives the raw key of an epoch, bypassing the cache.
+ *
+ * NIST SP 800-108 counter-mode KDF with AES-CMAC as PRF:
+ * K = CMAC(master, 0x01 || label || 0x00 || epoch || 0x0080).
+ *
+ * @param epoch Epoch number (session or day index).
+ * @param key   Output: 128-bit epoch key (16 bytes).
+ */
+void kdf_derive_key(uint32_t epoch, uint8_t *key);
+
+/**
+ * @brief Returns the expanded AEAD context of an epoch.
+ *
+ * A hit costs a short scan of the cache. A miss derives the key and
+ * expands it into the least recently used slot.
+ *
+ * @param epoch Epoch number.
+ * @return const aes_gcm_ctx_t* Context, valid until evicted.
+ */
+const aes_gcm_ctx_t *kdf_get_ctx(uint32_t epoch);
+
+/**
+ * @brief Derives the epoch after current_epoch if it is not cached yet.
+ *
+ * Call from the main loop when idle so that the next epoch is never a miss
+ * on the packet path.
+ *
+ * @param current_epoch Epoch currently in use.
+ */
+void kdf_background(uint32_t current_epoch);
+
+/**
+ * @brief Returns the cache counters.
+ */
+const kdf_stats_t *kdf_get_stats(void);
+
+#endif /* KDF_H */
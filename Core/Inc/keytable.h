@@ -0,0 +1,178 @@
+#ifndef KEYTABLE_H
+#define KEYTABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "aes_gcm.h"
+#include "nonce.h"
+
+// Number of slots in the table, must be a power of two
+#define KEYTABLE_SIZE 64
+
+// Key hint byte carried in the frame header
+#define KEY_HINT_ID_MASK   0x7F
+#define KEY_HINT_EPOCH_BIT 0x80
+
+// How long the previous epoch is still accepted after a rotation
+#define KEYTABLE_GRACE_MS  60000
+
+typedef enum {
+    KEY_SLOT_EMPTY = 0,
+    KEY_SLOT_ACTIVE,     // Used for TX and accepted on RX
+    KEY_SLOT_NEXT,       // Expanded ahead of time, accepted on RX
+    KEY_SLOT_RETIRING    // Previous epoch, accepted until the grace period ends
+} key_slot_state_t;
+
+typedef struct {
+    key_slot_state_t state;
+    uint32_t         retire_at;
+    aes_gcm_ctx_t    ctx;
+    nonce_window_t   window;       // Cleared whenever the slot gets a key
+    nonce_window_t   frag_window;  // Message counters of fragments, cleared with window
+} key_slot_t;
+
+/**
+ * @brief One peer key with two precomputed AEAD contexts.
+ *
+ * slot[0] and slot[1] belong to epoch bit 0 and 1, so epoch n always lives
+ * in slot[n & 1]. Rotation only advances the epoch; the new context was
+ * expanded by keytable_stage_next(). Each epoch has its own replay window,
+ * which starts empty when its key is installed, so a new epoch does not
+ * inherit the counters seen under the last one. Within an epoch the peer's
+ * counter never goes back, since nonce_resume() carries it over resets.
+ * Fragmented messages keep a window of their own: their fragments are
+ * repeated long after newer frames went out, and only one message is in
+ * flight at a time, so that window moves by one per message.
+ */
+typedef struct {
+    bool           used;
+    uint8_t        peer;
+    uint8_t        key_id;
+    uint32_t       epoch;        // Active epoch, also advanced when following the peer
+    key_slot_t     slot[2];
+} keytable_entry_t;
+
+/**
+ * @brief Empties the key table.
+ */
+void keytable_init(void);
+
+/**
+ * @brief Adds or replaces the key of a peer.
+ *
+ * The AEAD context is expanded here, not on the per-frame path. The key
+ * becomes the active epoch and any staged key is dropped.
+ *
+ * @param peer   Peer node address.
+ * @param key_id Key ID (7 bits) announced in the peer's frames.
+ * @param epoch  Epoch the key belongs to.
+ * @param key    128-bit AES key.
+ * @return bool  False if the table is full.
+ */
+bool keytable_add(uint8_t peer, uint8_t key_id, uint32_t epoch, const uint8_t *key);
+
+/**
+ * @brief Finds the key for a received frame in O(1).
+ *
+ * @param peer     Source address from the frame header.
+ * @param key_hint Key hint byte from the frame header; the epoch bit is ignored.
+ * @return keytable_entry_t* Matching entry, or NULL if unknown.
+ */
+keytable_entry_t *keytable_lookup(uint8_t peer, uint8_t key_hint);
+
+/**
+ * @brief Expands the key of epoch + 1 into its slot.
+ *
+ * Frames from the peer under the new epoch are accepted from now on.
+ *
+ * @param entry Peer entry.
+ * @param key   128-bit AES key of the next epoch.
+ * @return bool False if the inactive slot is still in its grace period.
+ */
+bool keytable_stage_next(keytable_entry_t *entry, const uint8_t *key);
+
+/**
+ * @brief Stages an already expanded context as the next epoch.
+ *
+ * Same as keytable_stage_next() for keys that come out of the KDF cache,
+ * so no expansion happens here at all.
+ *
+ * @param entry Peer entry.
+ * @param ctx   Context of the next epoch.
+ * @return bool False if the inactive slot is still in its grace period.
+ */
+bool keytable_stage_next_ctx(keytable_entry_t *entry, const aes_gcm_ctx_t *ctx);
+
+/**
+ * @brief Switches TX to the staged epoch and advances entry->epoch.
+ *
+ * The previous epoch stays accepted on RX for KEYTABLE_GRACE_MS.
+ *
+ * @param entry Peer entry.
+ * @return bool False if no next key was staged.
+ */
+bool keytable_rotate(keytable_entry_t *entry);
+
+/**
+ * @brief Jumps to an epoch that is not adjacent to the current one.
+ *
+ * For a peer that was off for more than an epoch. Both slots are
+ * replaced: the context becomes the active epoch, nothing stays staged
+ * or retiring.
+ *
+ * @param entry Peer entry.
+ * @param epoch New epoch.
+ * @param ctx   Context of that epoch.
+ */
+void keytable_resync(keytable_entry_t *entry, uint32_t epoch, const aes_gcm_ctx_t *ctx);
+
+/**
+ * @brief Selects the RX context for the epoch bit of a frame.
+ *
+ * @param entry    Peer entry from keytable_lookup().
+ * @param key_hint Key hint byte from the frame header.
+ * @return const aes_gcm_ctx_t* Context, or NULL if that epoch is not loaded.
+ */
+const aes_gcm_ctx_t *keytable_rx_ctx(const keytable_entry_t *entry, uint8_t key_hint);
+
+/**
+ * @brief Selects the replay window for the epoch bit of a frame.
+ *
+ * @param entry    Peer entry from keytable_lookup().
+ * @param key_hint Key hint byte from the frame header.
+ * @param fragment True for FRAME_TYPE_FRAGMENT frames.
+ * @return nonce_window_t* Window of that epoch and kind of frame.
+ */
+nonce_window_t *keytable_rx_window(keytable_entry_t *entry, uint8_t key_hint, bool fragment);
+
+/**
+ * @brief Records that a frame authenticated under an epoch.
+ *
+ * If the peer already moved to the staged epoch, we rotate as well, so
+ * entry->epoch follows a peer that crossed the epoch boundary first.
+ *
+ * @param entry    Peer entry.
+ * @param key_hint Key hint byte of the authenticated frame.
+ */
+void keytable_rx_confirm(keytable_entry_t *entry, uint8_t key_hint);
+
+/**
+ * @brief Returns the TX context of the active epoch.
+ */
+const aes_gcm_ctx_t *keytable_tx_ctx(const keytable_entry_t *entry);
+
+/**
+ * @brief Returns the key hint byte to send with the active epoch.
+ */
+uint8_t keytable_tx_hint(const keytable_entry_t *entry);
+
+/**
+ * @brief Drops retiring epochs whose grace period has ended.
+ *
+ * Call periodically from the main loop, off the per-packet path.
+ *
+ * @param now Current time in milliseconds (e.g. HAL_GetTick()).
+ */
+void keytable_tick(uint32_t now);
+
+#endif /* KEYTABLE_H */
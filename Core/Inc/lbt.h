@@ -0,0 +1,66 @@
+#ifndef LBT_H
+#define LBT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Listen-before-talk policy. Every frame is preceded by a CAD; while the
+ * channel is busy the sender backs off for a random number of slots drawn
+ * from a window that doubles with each busy CAD.
+ */
+
+#define LBT_SLOT_MS        10   // Backoff unit, a few CAD durations at SF7
+#define LBT_MAX_EXPONENT   6    // Contention window stops growing at 64 slots
+#define LBT_MAX_ATTEMPTS   8    // Busy CADs before a frame is dropped
+
+/**
+ * @brief Channel access counters.
+ */
+typedef struct {
+    uint32_t cad_runs;      // CADs completed
+    uint32_t busy;          // CADs that detected a preamble (collisions avoided)
+    uint32_t backoffs;      // Backoff periods started
+    uint32_t backoff_ms;    // Total time spent backing off
+    uint32_t dropped;       // Frames abandoned after LBT_MAX_ATTEMPTS
+} lbt_stats_t;
+
+/**
+ * @brief Seeds the backoff generator and clears the counters.
+ *
+ * @param seed    Random seed, e.g. SX1272_ReadEntropy(). Nodes must not share it.
+ * @param enabled False sends without CAD.
+ */
+void lbt_init(uint32_t seed, bool enabled);
+
+/**
+ * @brief Returns true if frames must be preceded by a CAD.
+ */
+bool lbt_enabled(void);
+
+/**
+ * @brief Records the outcome of a CAD.
+ *
+ * @param busy True if CadDetected was set.
+ */
+void lbt_record_cad(bool busy);
+
+/**
+ * @brief Draws the backoff before the next CAD.
+ *
+ * @param attempt Number of busy CADs for this frame so far (1 = first).
+ * @return uint32_t Delay in milliseconds, 1..2^min(attempt, LBT_MAX_EXPONENT) slots.
+ */
+uint32_t lbt_backoff(uint8_t attempt);
+
+/**
+ * @brief Records a frame dropped because the channel stayed busy.
+ */
+void lbt_record_drop(void);
+
+/**
+ * @brief Returns the channel access counters.
+ */
+const lbt_stats_t *lbt_get_stats(void);
+
+#endif /* LBT_H */
@@ -0,0 +1,106 @@
+#ifndef LORA_FRAME_H
+#define LORA_FRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "aes_gcm.h"
+
+/*
+ * Over-the-air frame layout:
+ *
+ *   | net_id | dst | src | type | key | counter (4, big-endian) | ciphertext | tag (16) |
+ *
+ * The header travels in clear and is authenticated as AAD, so the receiver
+ * can discard foreign or replayed frames before touching any crypto.
+ * The key byte holds a 7-bit key ID and an epoch bit (see keytable.h) so a
+ * gateway picks the right key without trial decryption.
+ */
+#define FRAME_OFF_NET_ID      0
+#define FRAME_OFF_DST         1
+#define FRAME_OFF_SRC         2
+#define FRAME_OFF_TYPE        3
+#define FRAME_OFF_KEY         4
+#define FRAME_OFF_COUNTER     5
+#define FRAME_HEADER_SIZE     9
+
+#define FRAME_OVERHEAD        (FRAME_HEADER_SIZE + GCM_TAG_SIZE)
+#define FRAME_MAX_SIZE        255
+#define FRAME_MAX_PAYLOAD     (FRAME_MAX_SIZE - FRAME_OVERHEAD)
+
+#define FRAME_ADDR_BROADCAST  0xFF
+
+// Frame types
+#define FRAME_TYPE_DATA       0x00
+#define FRAME_TYPE_CONTROL    0x01
+#define FRAME_TYPE_BEACON     0x02
+#define FRAME_TYPE_FRAGMENT   0x03    // Part of a longer message, see frag.h
+#define FRAME_TYPE_FRAG_STATUS 0x04
+#define FRAME_TYPE_ARQ        0x05    // Reliable, see arq.h
+#define FRAME_TYPE_ARQ_ACK    0x06
+#define FRAME_TYPE_EPOCH      0x07    // Sender's key epoch, under the sync key
+
+typedef struct {
+    uint8_t  net_id;
+    uint8_t  dst;
+    uint8_t  src;
+    uint8_t  type;
+    uint8_t  key_hint;
+    uint32_t counter;
+} lora_frame_header_t;
+
+/**
+ * @brief Parses the clear-text header of a received frame.
+ *
+ * @param frame  Raw frame, at least FRAME_HEADER_SIZE bytes.
+ * @param header Output header.
+ */
+void lora_frame_parse_header(const uint8_t *frame, lora_frame_header_t *header);
+
+/**
+ * @brief Writes the clear-text header of a frame.
+ *
+ * @param header Header to write.
+ * @param frame  Output buffer, at least FRAME_HEADER_SIZE bytes.
+ */
+void lora_frame_write_header(const lora_frame_header_t *header, uint8_t *frame);
+
+/**
+ * @brief Builds the 96-bit GCM nonce for a frame.
+ *
+ * The nonce combines network, source and counter, so two senders sharing a
+ * key never reuse a nonce as long as each one keeps its counter unique.
+ *
+ * @param header Frame header.
+ * @param nonce  Output buffer (GCM_NONCE_SIZE bytes).
+ */
+void lora_frame_build_nonce(const lora_frame_header_t *header, uint8_t *nonce);
+
+/**
+ * @brief Encrypts a payload and writes the complete frame.
+ *
+ * @param ctx         AEAD context of the key named in header->key_hint.
+ * @param header      Header to send; counter must come from nonce_generate().
+ * @param payload     Plaintext payload.
+ * @param payload_len Length of payload, at most FRAME_MAX_PAYLOAD.
+ * @param frame       Output buffer, at least payload_len + FRAME_OVERHEAD bytes.
+ * @return uint8_t    Length of the frame, or 0 if the payload is too long.
+ */
+uint8_t lora_frame_seal(const aes_gcm_ctx_t *ctx, const lora_frame_header_t *header,
+                        const uint8_t *payload, uint8_t payload_len,
+                        uint8_t *frame);
+
+/**
+ * @brief Authenticates and decrypts a frame whose header was already parsed.
+ *
+ * @param ctx         AEAD context selected from the key hint.
+ * @param header      Parsed header of the frame.
+ * @param frame       Raw frame.
+ * @param frame_len   Length of the raw frame, at least FRAME_OVERHEAD.
+ * @param payload     Output buffer, at least frame_len - FRAME_OVERHEAD bytes.
+ * @return bool       True if the tag verified.
+ */
+bool lora_frame_open(const aes_gcm_ctx_t *ctx, const lora_frame_header_t *header,
+                     const uint8_t *frame, uint8_t frame_len,
+                     uint8_t *payload);
+
+#endif /* LORA_FRAME_H */
@@ -59,6 +59,13 @@ void Error_Handler(void);
 /* Private defines -----------------------------------------------------------*/
 
 /* USER CODE BEGIN Private defines */
+// SX1272 wiring
+#define LORA_NSS_GPIO_Port    GPIOA
+#define LORA_NSS_Pin          GPIO_PIN_4
+#define LORA_RESET_GPIO_Port  GPIOA
+#define LORA_RESET_Pin        GPIO_PIN_3
+#define LORA_DIO0_GPIO_Port   GPIOB
+#define LORA_DIO0_Pin         GPIO_PIN_0
 
 /* USER CODE END Private defines */
 
@@ -4,6 +4,24 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+// Number of counters behind the newest one that are still tracked for replay
+#define NONCE_WINDOW_SIZE 32
+
+// Counters reserved per nonce_resume() store; after a reset at most this
+// many are skipped
+#define NONCE_RESERVE_BLOCK 1024
+
+/**
+ * @brief Sliding replay window for one sender.
+ *
+ * Bit n of the bitmap marks (last - n) as already received. An all-zero
+ * bitmap means nothing has been received yet.
+ */
+typedef struct {
+    uint32_t last;
+    uint32_t bitmap;
+} nonce_window_t;
+
 /**
  * @brief Initializes the nonce system.
  * 
@@ -11,6 +29,19 @@
  */
 void nonce_init(void);
 
+/**
+ * @brief Continues counting after a reset instead of restarting at zero.
+ *
+ * Counters are handed out in blocks: before the first counter of a block
+ * goes out, reserve() is called with the end of the block and has to store
+ * it where it survives a reset. The stored value is the start after the
+ * next reset, so no counter is ever sent twice under the same key.
+ *
+ * @param start   Limit stored by reserve() before the reset, 0 at first boot.
+ * @param reserve Stores a new limit; called from nonce_generate().
+ */
+void nonce_resume(uint32_t start, void (*reserve)(uint32_t limit));
+
 /**
  * @brief Generates and returns the next nonce value for transmission.
  * 
@@ -31,4 +62,32 @@ uint32_t nonce_generate(void);
  */
 bool nonce_validate(uint32_t received_nonce);
 
+/**
+ * @brief Clears a replay window so that any counter is accepted next.
+ *
+ * @param window Window to reset.
+ */
+void nonce_window_init(nonce_window_t *window);
+
+/**
+ * @brief Checks a received counter against a replay window without updating it.
+ *
+ * This is cheap enough to run before decryption. Only call
+ * nonce_window_update() once the frame has been authenticated, otherwise a
+ * forged frame could move the window forward.
+ *
+ * @param window  Replay window of the sender.
+ * @param counter Counter received in the frame.
+ * @return bool   True if the counter is new and inside the window.
+ */
+bool nonce_window_check(const nonce_window_t *window, uint32_t counter);
+
+/**
+ * @brief Marks a counter as received.
+ *
+ * @param window  Replay window of the sender.
+ * @param counter Counter of an authenticated frame.
+ */
+void nonce_window_update(nonce_window_t *window, uint32_t counter);
+
 #endif /* NONCE_H */
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef RADIO_EVENT_H
+#define RADIO_EVENT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Queue depth, must be a power of two
+#define RADIO_EVENT_QUEUE_SIZE 8
+
+typedef enum {
+    RADIO_EVT_NONE = 0,
+    RADIO_EVT_RX_DONE,      // A frame was committed to the RX ring
+    RADIO_EVT_TX_DONE       // A frame left the air, the TX queue has room
+} radio_event_type_t;
+
+typedef struct {
+    radio_event_type_t type;
+    uint32_t           tick;   // HAL_GetTick() when the event was posted
+} radio_event_t;
+
+/**
+ * @brief Empties the queue and clears the drop counter.
+ */
+void radio_event_init(void);
+
+/**
+ * @brief Posts an event; called from interrupt context (single producer).
+ *
+ * @param type Event type.
+ * @param tick Current time in milliseconds.
+ * @return bool False if the queue was full and the event was dropped.
+ */
+bool radio_event_post(radio_event_type_t type, uint32_t tick);
+
+/**
+ * @brief Takes the oldest event; called from the main loop (single consumer).
+ *
+ * @param event Output event.
+ * @return bool False if the queue is empty.
+ */
+bool radio_event_get(radio_event_t *event);
+
+/**
+ * @brief Returns true if at least one event is waiting.
+ */
+bool radio_event_pending(void);
+
+/**
+ * @brief Returns how many events were dropped because the queue was full.
+ */
+uint32_t radio_event_dropped(void);
+
+#endif /* RADIO_EVENT_H */
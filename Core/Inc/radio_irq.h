@@ -0,0 +1,108 @@
+#ifndef RADIO_IRQ_H
+#define RADIO_IRQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sx1272.h"
+
+/*
+ * Deferred radio interrupt handling.
+ *
+ * The DIO0 EXTI top half only latches the edge and pends PendSV. The
+ * bottom half runs at PendSV, the lowest priority, so the SPI work of
+ * SX1272_HandleDIO0() never blocks SysTick or any other interrupt.
+ * There is one bottom half, so it serves one radio; other radios on the
+ * board are driven by the application directly.
+ */
+
+// PendSV must stay below SysTick (TICK_INT_PRIORITY) so HAL_GetTick() keeps counting
+#define RADIO_IRQ_BH_PRIORITY 15
+
+// Traffic classes selectable per frame with tx_frame_t.traffic_class
+#define RADIO_CLASS_COUNT     4
+
+/**
+ * @brief Sets the PendSV priority, clears the latch and starts the DWT
+ *        cycle counter used to timestamp received packets.
+ *
+ * @param instance Radio served by the bottom half; SX1272_Init() may follow.
+ */
+void radio_irq_init(sx1272_t *instance);
+
+/**
+ * @brief Top half: call from the DIO0 EXTI callback.
+ *
+ * @param tick Current time in milliseconds.
+ */
+void radio_irq_dio0(uint32_t tick);
+
+/**
+ * @brief Asks the bottom half to start transmitting newly queued frames.
+ */
+void radio_irq_kick(void);
+
+/**
+ * @brief Switches the modem parameters once the TX queue has drained.
+ *
+ * Frames queued before the call still go out with the old parameters.
+ */
+void radio_irq_set_modem(const SX1272_ModemParams_t *params);
+
+/**
+ * @brief Hops to a channel_plan channel before the next frame.
+ *
+ * A frame already on the air or waiting for a clear CAD finishes first.
+ */
+void radio_irq_set_channel(uint8_t channel);
+
+/**
+ * @brief Sets the LoRa header mode of a traffic class.
+ *
+ * Implicit classes drop the PHY header, which saves airtime but fixes the
+ * frame size: frames of another length are dropped, and the receiver must
+ * listen in the same class. Configure classes before queueing frames.
+ *
+ * @param tclass   Traffic class, below RADIO_CLASS_COUNT.
+ * @param implicit True for implicit header mode.
+ * @param length   Frame length of an implicit class.
+ */
+void radio_irq_set_class(uint8_t tclass, bool implicit, uint8_t length);
+
+/**
+ * @brief Selects the traffic class the receiver listens for between frames.
+ */
+void radio_irq_set_rx_class(uint8_t tclass);
+
+/**
+ * @brief Resumes frames held by LBT backoff or the duty-cycle budget; call from the main loop.
+ *
+ * @param now Current time in milliseconds.
+ */
+void radio_irq_poll(uint32_t now);
+
+/**
+ * @brief Bottom half: call from PendSV_Handler().
+ *
+ * Services a latched DIO0 and tells the main loop through radio_event:
+ * RADIO_EVT_RX_DONE once frames reach the RX ring, RADIO_EVT_TX_DONE once a
+ * frame is sent. Then starts the next tx_queue frame if the radio is not
+ * already sending. On TxDone the next frame is loaded at once, so queued frames go out back to
+ * back. Frames are held while their sub-band has no duty-cycle budget left,
+ * and with LBT each frame waits for a clear CAD. If a FIFO DMA burst still
+ * owns the bus it retries when the burst ends.
+ */
+void radio_irq_bottom_half(void);
+
+/**
+ * @brief Keeps the bottom half from running while thread code uses the radio.
+ *
+ * SysTick and higher priority interrupts stay enabled. Calls do not nest.
+ */
+void radio_irq_lock(void);
+
+/**
+ * @brief Releases radio_irq_lock(); a bottom half pended meanwhile runs now.
+ */
+void radio_irq_unlock(void);
+
+#endif /* RADIO_IRQ_H */
@@ -0,0 +1,83 @@
+#ifndef RX_FILTER_H
+#define RX_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lora_frame.h"
+
+/**
+ * @brief Outcome of rx_filter_process(), one value per filter stage.
+ *
+ * Stages run in this order and the first failing one rejects the frame,
+ * so the cheap checks shed foreign traffic before any crypto runs.
+ */
+typedef enum {
+    RX_FILTER_ACCEPT = 0,
+    RX_FILTER_FRAGMENT,         // Fragment stored, its message is not complete yet
+    RX_FILTER_REJECT_NETWORK,   // Network ID differs from ours
+    RX_FILTER_REJECT_ADDRESS,   // Neither our address nor broadcast
+    RX_FILTER_REJECT_LENGTH,    // Too short to hold header and tag
+    RX_FILTER_REJECT_KEY,       // No key for this source, key ID and epoch
+    RX_FILTER_REJECT_REPLAY,    // Counter already seen or too old
+    RX_FILTER_REJECT_AUTH,      // Tag did not verify
+    RX_FILTER_RESULT_COUNT
+} rx_filter_result_t;
+
+/**
+ * @brief Per-stage counters.
+ *
+ * rejected[] is indexed by rx_filter_result_t; rejected[RX_FILTER_ACCEPT]
+ * and rejected[RX_FILTER_FRAGMENT] stay zero.
+ */
+typedef struct {
+    uint32_t received;
+    uint32_t accepted;
+    uint32_t fragments;
+    uint32_t rejected[RX_FILTER_RESULT_COUNT];
+} rx_filter_stats_t;
+
+/**
+ * @brief Configures the filter and clears the counters.
+ *
+ * Keys and their replay windows live in the key table (keytable.h).
+ *
+ * @param net_id     Network ID expected in every frame.
+ * @param local_addr Our node address.
+ */
+void rx_filter_init(uint8_t net_id, uint8_t local_addr);
+
+/**
+ * @brief Runs a received frame through all filter stages.
+ *
+ * Call this with the buffer filled by SX1272_HandleDIO0(). The key is picked
+ * from the header's key hint, and the replay window of that key epoch is only
+ * advanced after the tag has verified.
+ *
+ * A FRAME_TYPE_FRAGMENT frame goes to the reassembly pool (frag.h) instead
+ * of being decrypted. The fragment that completes a message is accepted
+ * once the whole message authenticates; payload_len is then 0 and the
+ * plaintext is read with frag_rx_message().
+ *
+ * @param frame       Raw frame as read from the radio FIFO.
+ * @param frame_len   Length of the raw frame.
+ * @param header      Output: parsed header, valid if the result is ACCEPT.
+ * @param payload     Output buffer, at least FRAME_MAX_PAYLOAD bytes. May be
+ *                    frame + FRAME_HEADER_SIZE to decrypt in place.
+ * @param payload_len Output: decrypted payload length.
+ * @return rx_filter_result_t RX_FILTER_ACCEPT or the stage that rejected.
+ */
+rx_filter_result_t rx_filter_process(const uint8_t *frame, uint8_t frame_len,
+                                     lora_frame_header_t *header,
+                                     uint8_t *payload, uint8_t *payload_len);
+
+/**
+ * @brief Returns the filter counters.
+ */
+const rx_filter_stats_t *rx_filter_get_stats(void);
+
+/**
+ * @brief Clears the filter counters.
+ */
+void rx_filter_reset_stats(void);
+
+#endif /* RX_FILTER_H */
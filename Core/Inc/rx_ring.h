@@ -0,0 +1,69 @@
+#ifndef RX_RING_H
+#define RX_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Number of packet slots, must be a power of two
+#define RX_RING_SLOTS        4
+#define RX_RING_PAYLOAD_MAX  255
+
+/**
+ * @brief One received packet with its link metadata.
+ */
+typedef struct {
+    uint8_t  length;
+    int16_t  rssi;        // Packet RSSI in dBm
+    int8_t   snr;         // Packet SNR in dB
+    int32_t  freq_error;  // Carrier offset of the sender from the FEI, in Hz
+    uint32_t timestamp;   // HAL tick when the top half saw DIO0
+    uint32_t cycles;      // DWT cycle count latched in the same interrupt
+    uint8_t  data[RX_RING_PAYLOAD_MAX];
+} rx_packet_t;
+
+/**
+ * @brief Lock-free single-producer/single-consumer ring of packet slots.
+ *
+ * The radio interrupt path claims a slot, reads the FIFO straight into it
+ * and commits it. The application peeks at the oldest slot, processes it in
+ * place and releases it. Only the producer writes head and only the
+ * consumer writes tail.
+ */
+typedef struct {
+    rx_packet_t       slot[RX_RING_SLOTS];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t dropped;
+} rx_ring_t;
+
+/**
+ * @brief Empties the ring.
+ */
+void rx_ring_init(rx_ring_t *ring);
+
+/**
+ * @brief Producer: returns the next free slot without publishing it.
+ *
+ * @return rx_packet_t* Slot to fill, or NULL if the ring is full (counted as dropped).
+ */
+rx_packet_t *rx_ring_claim(rx_ring_t *ring);
+
+/**
+ * @brief Producer: publishes the slot returned by the last rx_ring_claim().
+ */
+void rx_ring_commit(rx_ring_t *ring);
+
+/**
+ * @brief Consumer: returns the oldest packet without removing it.
+ *
+ * @return rx_packet_t* Packet, or NULL if the ring is empty.
+ */
+rx_packet_t *rx_ring_peek(rx_ring_t *ring);
+
+/**
+ * @brief Consumer: frees the packet returned by rx_ring_peek().
+ */
+void rx_ring_release(rx_ring_t *ring);
+
+#endif /* RX_RING_H */
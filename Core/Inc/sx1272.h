@@ -9,20 +9,14 @@
 #define INC_SX1272_H_
 
 #include "stm32g4xx_hal.h"
+#include "rx_ring.h"
 #include <stdint.h>
-
-// Pin connections
-#define SX1272_NSS_PORT      GPIOA
-#define SX1272_NSS_PIN       GPIO_PIN_4
-#define SX1272_RESET_PORT    GPIOA
-#define SX1272_RESET_PIN     GPIO_PIN_3
-
-#define SX1272_DIO0_PORT     GPIOB
-#define SX1272_DIO0_PIN      GPIO_PIN_0
+#include <stdbool.h>
 
 // SX1272 registers
 #define REG_FIFO                 0x00
 #define REG_OP_MODE              0x01
+#define REG_PA_CONFIG            0x09
 #define REG_FIFO_ADDR_PTR        0x0D
 #define REG_FIFO_TX_BASE_ADDR    0x0E
 #define REG_FIFO_RX_BASE_ADDR    0x0F
@@ -34,13 +28,20 @@
 #define REG_MODEM_CONFIG1        0x1D
 #define REG_MODEM_CONFIG2        0x1E
 #define REG_PAYLOAD_LENGTH       0x22
+#define REG_MAX_PAYLOAD_LENGTH   0x23
+#define REG_FEI_MSB              0x28
+#define REG_FEI_LSB              0x2A
+#define REG_RSSI_WIDEBAND        0x2C
 #define REG_DIO_MAPPING1         0x40
 #define REG_IRQ_FLAGS_MASK       0x11
+#define REG_VERSION              0x42
 
 // IRQ Masks
 #define IRQ_TX_DONE_MASK   0x08
 #define IRQ_RX_DONE_MASK   0x40
 #define IRQ_CRC_ERROR_MASK 0x20
+#define IRQ_CAD_DONE_MASK  0x04
+#define IRQ_CAD_DETECTED_MASK 0x01
 
 // LoRa modes
 #define SX1272_MODE_LORA   0x80
@@ -48,27 +49,156 @@
 #define SX1272_MODE_STDBY  0x01
 #define SX1272_MODE_TX     0x03
 #define SX1272_MODE_RX_CONT 0x05
+#define SX1272_MODE_CAD    0x07
+
+// Packet RSSI in dBm = SX1272_RSSI_OFFSET + REG_PKT_RSSI_VALUE
+#define SX1272_RSSI_OFFSET (-139)
 
 // Frequency registers (add to existing register definitions)
 #define REG_FRF_MSB              0x06
 #define REG_FRF_MID              0x07
 #define REG_FRF_LSB              0x08
 
-extern SPI_HandleTypeDef hspi1;
+// Define SX1272_USE_LL_SPI (e.g. -DSX1272_USE_LL_SPI) to run single
+// register reads/writes on LL SPI/GPIO polling instead of the HAL calls
+
+// FIFO partition used by SX1272_SetFifoSplit(true): RX from 0x00, TX from
+// 0x80, each region holds one frame of up to SX1272_FIFO_SPLIT_SIZE bytes
+#define SX1272_FIFO_SPLIT_TX_BASE  0x80
+#define SX1272_FIFO_SPLIT_SIZE     0x80
+
+// Modem parameter ranges for SX1272_SetModemParams(). Bandwidth stays at
+// 125 kHz; the PA runs on the RFO pin, Pout = -1 + OutputPower dBm.
+#define SX1272_SF_MIN        7
+#define SX1272_SF_MAX        12
+#define SX1272_CR_4_5        1
+#define SX1272_CR_4_8        4
+#define SX1272_POWER_MIN     (-1)
+#define SX1272_POWER_MAX     14
+
+#define SX1272_BW_HZ           125000
+#define SX1272_PREAMBLE_LENGTH 8        // REG_PREAMBLE reset value
+#define SX1272_DEFAULT_FREQ    868100000
+
+// Longest register run handled by SX1272_WriteRegs/ReadRegs; WriteRegs also
+// stops at 0x7F
+#define SX1272_BURST_MAX   32
+
+// Radios that may run SPI DMA bursts, looked up from the HAL SPI callbacks
+#define SX1272_MAX_RADIOS  4
+
+// Register shadow counters: SPI write transactions issued and dropped
+// because the radio already held the value
+typedef struct {
+    uint32_t writes;
+    uint32_t skipped;
+} SX1272_ShadowStats_t;
+
+// Data rate and output power of the link
+typedef struct {
+    uint8_t sf;       // Spreading factor, SX1272_SF_MIN..SX1272_SF_MAX
+    uint8_t cr;       // Coding rate 4/(4+cr), SX1272_CR_4_5..SX1272_CR_4_8
+    int8_t  power;    // Output power in dBm, SX1272_POWER_MIN..SX1272_POWER_MAX
+} SX1272_ModemParams_t;
+
+// Result of SX1272_BenchmarkRegAccess()
+typedef struct {
+    uint32_t reads_per_sec;
+    uint32_t writes_per_sec;
+} SX1272_RegBench_t;
+
+typedef struct sx1272 sx1272_t;
+
+// DMA FIFO bursts: NSS stays low until the transfer completes, then the
+// callback runs from the DMA interrupt. No other SPI access to that radio
+// may start while SX1272_IsDmaBusy() is true.
+typedef void (*SX1272_DmaCallback)(sx1272_t *radio);
+
+// One radio: its bus and pins, set by the board code before SX1272_Init(),
+// and the driver state. Radios sharing a SPI bus must not overlap bursts.
+struct sx1272 {
+    SPI_HandleTypeDef *spi;
+    GPIO_TypeDef      *nssPort;
+    uint16_t           nssPin;
+    GPIO_TypeDef      *resetPort;
+    uint16_t           resetPin;
+    uint16_t           dio0Pin;      // EXTI line, for the application's dispatch
+    void              *user;         // Free for the owner of the radio
+
+    // Received packets, filled by SX1272_HandleDIO0() and drained by the application
+    rx_ring_t          rxRing;
+
+    // Private to the driver
+    volatile bool        dmaBusy;
+    SX1272_DmaCallback   dmaDone;
+    uint8_t              txPending;
+    volatile bool        txPreloaded;
+    bool                 txStartOnLoad;
+    bool                 fifoSplit;
+    uint32_t             frequency;
+    bool                 headerImplicit;
+    uint8_t              implicitLength;
+    SX1272_ModemParams_t modemParams;
+
+    // Write-through shadow of the configuration registers
+    uint8_t              shadow[0x80];
+    uint32_t             shadowValid[0x80 / 32];
+    SX1272_ShadowStats_t shadowStats;
+};
 
-extern uint8_t SX1272_RxBuffer[256];
-extern volatile uint8_t SX1272_RxLength;
+void SX1272_Reset(sx1272_t *radio);
+void SX1272_WriteReg(sx1272_t *radio, uint8_t addr, uint8_t data);
+uint8_t SX1272_ReadReg(sx1272_t *radio, uint8_t addr);
+void SX1272_WriteRegs(sx1272_t *radio, uint8_t addr, const uint8_t *values, uint8_t count);
+void SX1272_ReadRegs(sx1272_t *radio, uint8_t addr, uint8_t *values, uint8_t count);
+void SX1272_ShadowInvalidate(sx1272_t *radio);
+const SX1272_ShadowStats_t *SX1272_GetShadowStats(const sx1272_t *radio);
+void SX1272_BenchmarkRegAccess(sx1272_t *radio, uint32_t iterations, SX1272_RegBench_t *result);
+void SX1272_WriteBuffer(sx1272_t *radio, uint8_t addr, uint8_t *buffer, uint8_t size);
+void SX1272_ReadBuffer(sx1272_t *radio, uint8_t addr, uint8_t *buffer, uint8_t size);
 
-void SX1272_Reset(void);
-void SX1272_WriteReg(uint8_t addr, uint8_t data);
-uint8_t SX1272_ReadReg(uint8_t addr);
-void SX1272_WriteBuffer(uint8_t addr, uint8_t *buffer, uint8_t size);
-void SX1272_ReadBuffer(uint8_t addr, uint8_t *buffer, uint8_t size);
+HAL_StatusTypeDef SX1272_WriteBufferDMA(sx1272_t *radio, uint8_t addr, uint8_t *buffer, uint8_t size, SX1272_DmaCallback done);
+HAL_StatusTypeDef SX1272_ReadBufferDMA(sx1272_t *radio, uint8_t addr, uint8_t *buffer, uint8_t size, SX1272_DmaCallback done);
+bool SX1272_IsDmaBusy(const sx1272_t *radio);
+void SX1272_BusIdleCallback(sx1272_t *radio);
+// Called once a received frame is committed to the RX ring, possibly from the DMA interrupt
+void SX1272_RxDoneCallback(sx1272_t *radio);
+// Called on TxDone; return true if another SX1272_Transmit() was started
+bool SX1272_TxDoneCallback(sx1272_t *radio);
+// Called on CadDone; return true if TX or another CAD was started,
+// otherwise the driver returns to RX
+bool SX1272_CadDoneCallback(sx1272_t *radio, bool detected);
 
-void SX1272_Init(void);
-void SX1272_SetupLora(void);
-void SX1272_Transmit(uint8_t *data, uint8_t size);
-void SX1272_Receive(void);
-void SX1272_HandleDIO0(void);
+// Resets the driver state apart from the wiring and brings the radio up in LoRa standby
+void SX1272_Init(sx1272_t *radio);
+void SX1272_SetupLora(sx1272_t *radio);
+void SX1272_SetFrequency(sx1272_t *radio, uint32_t freq);
+// Tunes to precomputed FRF register values; freq is only recorded
+void SX1272_SetFrf(sx1272_t *radio, const uint8_t frf[3], uint32_t freq);
+uint32_t SX1272_GetFrequency(const sx1272_t *radio);
+// Time on air of a frame of size bytes with the current modem parameters, in µs
+uint32_t SX1272_TimeOnAir(const sx1272_t *radio, uint8_t size, bool implicit);
+// Leaves the radio in standby; out-of-range values are clamped
+void SX1272_SetModemParams(sx1272_t *radio, const SX1272_ModemParams_t *params);
+const SX1272_ModemParams_t *SX1272_GetModemParams(const sx1272_t *radio);
+// Implicit header: no length/CR/CRC header on air, every frame in both
+// directions is exactly length bytes. Takes effect at the next RX or TX.
+void SX1272_SetHeaderMode(sx1272_t *radio, bool implicit, uint8_t length);
+void SX1272_SetFifoSplit(sx1272_t *radio, bool enable);
+// Loads the frame and starts TX. Returns HAL_ERROR if the frame does not fit
+HAL_StatusTypeDef SX1272_Transmit(sx1272_t *radio, uint8_t *data, uint8_t size);
+// Split FIFO only: writes the next frame while the radio stays in RX,
+// SX1272_StartTx() then only switches the mode
+HAL_StatusTypeDef SX1272_PreloadTx(sx1272_t *radio, uint8_t *data, uint8_t size);
+// Returns HAL_BUSY while the preload burst is still running
+HAL_StatusTypeDef SX1272_StartTx(sx1272_t *radio);
+void SX1272_Receive(sx1272_t *radio);
+// Runs one channel activity detection, ends with SX1272_CadDoneCallback()
+void SX1272_StartCad(sx1272_t *radio);
+// Collects 32 random bits from the wideband RSSI noise; the radio must be in RX
+uint32_t SX1272_ReadEntropy(sx1272_t *radio);
+// Returns false if a DMA burst was running and nothing was done; call again later.
+// tick (ms) and cycles (DWT) are the DIO0 edge time stored with a received packet.
+bool SX1272_HandleDIO0(sx1272_t *radio, uint32_t tick, uint32_t cycles);
 
 #endif /* INC_SX1272_H_ */
@@ -0,0 +1,121 @@
+#ifndef TDMA_H
+#define TDMA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Slotted MAC driven by gateway beacons.
+ *
+ * The gateway owns slot 0 of every superframe and sends a beacon in it that
+ * describes the superframe and which node owns each of the other slots.
+ * Nodes derive the superframe start from the end of the beacon minus its
+ * airtime, then transmit only inside their own slot, shrunk at both ends by
+ * a guard time that grows with the time since the last beacon to cover the
+ * crystal drift of both sides. A node that misses TDMA_BEACON_LOSS_MAX
+ * beacons in a row stops transmitting until it hears one again.
+ *
+ * Slot timing runs on TIM2 as a free-running 1 MHz counter with a compare
+ * interrupt at every slot edge.
+ */
+
+#define TDMA_MAX_SLOTS        16
+#define TDMA_CLOCK_PPM        20      // Crystal tolerance of each side
+#define TDMA_GUARD_MIN_US     1000    // Beacon latency, interrupt latency and FIFO load
+#define TDMA_BEACON_LOSS_MAX  4
+#define TDMA_TIMER_PRIORITY   1       // Above the radio bottom half, below DMA
+
+// Beacon payload: | seq (4, BE) | period_ms (2, BE) | slot_ms (2, BE) | count | owner[count] |
+#define TDMA_BEACON_HEADER    9
+#define TDMA_BEACON_MAX       (TDMA_BEACON_HEADER + TDMA_MAX_SLOTS)
+
+/**
+ * @brief Superframe layout carried by a beacon.
+ */
+typedef struct {
+    uint32_t seq;                    // Superframe number
+    uint16_t period_ms;              // Beacon to beacon
+    uint16_t slot_ms;
+    uint8_t  slot_count;             // Slot 0 is the gateway's beacon slot
+    uint8_t  owner[TDMA_MAX_SLOTS];  // Node address per slot
+} tdma_beacon_t;
+
+/**
+ * @brief Starts TIM2 as the 1 MHz slot timer.
+ */
+void tdma_timer_init(void);
+
+/**
+ * @brief Current slot timer value in microseconds.
+ */
+uint32_t tdma_now_us(void);
+
+/**
+ * @brief Turns the MAC on for a node or gateway.
+ *
+ * Until tdma_on_beacon() is called the node holds all frames.
+ *
+ * @param local_addr Address matched against the slot owners.
+ */
+void tdma_init(uint8_t local_addr);
+
+/**
+ * @brief Gateway: starts its own superframe grid and keeps it running.
+ *
+ * @param layout Superframe layout; owner[0] should be the gateway.
+ */
+void tdma_gateway_start(const tdma_beacon_t *layout);
+
+/**
+ * @brief Node: synchronises on a received beacon.
+ *
+ * @param beacon   Decoded beacon.
+ * @param start_us Superframe start in tdma_now_us() time: end of the beacon
+ *                 packet minus its airtime.
+ */
+void tdma_on_beacon(const tdma_beacon_t *beacon, uint32_t start_us);
+
+/**
+ * @brief Returns true once the MAC has been turned on.
+ */
+bool tdma_active(void);
+
+/**
+ * @brief Checks whether a frame fits into the rest of the current own slot.
+ *
+ * Always true while the MAC is off, so unslotted operation is unchanged.
+ *
+ * @param airtime_us Time on air of the frame.
+ */
+bool tdma_slot_allows(uint32_t airtime_us);
+
+/**
+ * @brief Superframe number, advanced locally between beacons.
+ */
+uint32_t tdma_superframe(void);
+
+/**
+ * @brief Gateway: the current superframe's beacon, if it still has to be queued.
+ *
+ * @param beacon Output: layout with the current sequence number.
+ * @return true  Once per superframe.
+ */
+bool tdma_beacon_due(tdma_beacon_t *beacon);
+
+/**
+ * @brief Guard time at each slot edge.
+ *
+ * @param since_sync_us Time since the superframe start was last measured.
+ * @return uint32_t Guard in microseconds.
+ */
+uint32_t tdma_guard_us(uint32_t since_sync_us);
+
+uint8_t tdma_beacon_encode(const tdma_beacon_t *beacon, uint8_t *payload);
+bool tdma_beacon_decode(const uint8_t *payload, uint8_t len, tdma_beacon_t *beacon);
+
+/**
+ * @brief Slot timer compare handler; call from TIM2_IRQHandler().
+ */
+void tdma_timer_irq(void);
+
+#endif /* TDMA_H */
@@ -0,0 +1,68 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Hashed timer wheel.
+ *
+ * Timers hang in one of TIMER_WHEEL_SLOTS buckets by their expiry tick, so
+ * starting and stopping one is O(1) and each tick only looks at one bucket.
+ * Timers further out than one revolution share a bucket with nearer ones
+ * and are skipped until their tick comes. Timers are embedded in the
+ * owner's structures; the wheel allocates nothing.
+ */
+
+#define TIMER_WHEEL_SLOTS  64    // Must be a power of two
+
+typedef struct timer_wheel_timer timer_wheel_timer_t;
+
+struct timer_wheel_timer {
+    timer_wheel_timer_t *next;   // NULL while stopped
+    timer_wheel_timer_t *prev;
+    uint32_t             expires;
+};
+
+typedef struct {
+    timer_wheel_timer_t bucket[TIMER_WHEEL_SLOTS];   // List heads
+    uint32_t            tick;      // Tick being processed
+    uint32_t            tick_ms;
+    uint32_t            tick_start;  // ms at which the current tick began
+} timer_wheel_t;
+
+/**
+ * @brief Empties the wheel.
+ *
+ * @param tick_ms Resolution; timers fire up to one tick late.
+ * @param now     Current time in ms.
+ */
+void timer_wheel_init(timer_wheel_t *wheel, uint32_t tick_ms, uint32_t now);
+
+/**
+ * @brief (Re)starts a timer; it fires after at least delay_ms.
+ */
+void timer_wheel_start(timer_wheel_t *wheel, timer_wheel_timer_t *timer, uint32_t delay_ms);
+
+/**
+ * @brief Stops a timer; stopping a stopped timer does nothing.
+ */
+void timer_wheel_stop(timer_wheel_timer_t *timer);
+
+/**
+ * @brief Returns true while a timer is running.
+ */
+bool timer_wheel_running(const timer_wheel_timer_t *timer);
+
+/**
+ * @brief Advances the wheel and takes off one timer that has expired.
+ *
+ * Call until it returns NULL. The timer is stopped when returned and may
+ * be restarted right away.
+ *
+ * @param now Current time in ms.
+ * @return timer_wheel_timer_t* Expired timer, or NULL.
+ */
+timer_wheel_timer_t *timer_wheel_expire(timer_wheel_t *wheel, uint32_t now);
+
+#endif /* TIMER_WHEEL_H */
@@ -0,0 +1,85 @@
+#ifndef TX_QUEUE_H
+#define TX_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define TX_QUEUE_SIZE        4
+#define TX_QUEUE_FRAME_MAX   255
+
+/**
+ * @brief Transmit priority, lower value goes first.
+ */
+typedef enum {
+    TX_PRIO_HIGH = 0,    // Control and acknowledgement frames
+    TX_PRIO_NORMAL,      // Application data
+    TX_PRIO_LOW,         // Bulk or best-effort traffic
+    TX_PRIO_COUNT
+} tx_priority_t;
+
+typedef enum {
+    TX_FRAME_FREE = 0,
+    TX_FRAME_FILLING,    // Owned by the application until tx_queue_submit()
+    TX_FRAME_QUEUED,
+    TX_FRAME_SENDING     // Owned by the radio until tx_queue_release()
+} tx_frame_state_t;
+
+typedef struct {
+    volatile uint8_t state;
+    uint8_t  priority;
+    uint8_t  traffic_class;  // Radio framing, see radio_irq_set_class(); 0 by default
+    uint8_t  length;
+    uint32_t seq;        // Submission order within a priority
+    uint8_t  data[TX_QUEUE_FRAME_MAX];
+} tx_frame_t;
+
+/**
+ * @brief Empties the queue.
+ */
+void tx_queue_init(void);
+
+/**
+ * @brief Takes a free frame for the application to build a packet in.
+ *
+ * @return tx_frame_t* Frame buffer, or NULL if all frames are in use.
+ */
+tx_frame_t *tx_queue_alloc(void);
+
+/**
+ * @brief Queues a frame returned by tx_queue_alloc().
+ *
+ * @param frame    Frame holding the packet.
+ * @param length   Packet length in bytes.
+ * @param priority Transmit priority.
+ */
+void tx_queue_submit(tx_frame_t *frame, uint8_t length, tx_priority_t priority);
+
+/**
+ * @brief Decides whether a queued frame may be sent now.
+ */
+typedef bool (*tx_queue_filter_t)(const tx_frame_t *frame);
+
+/**
+ * @brief Radio side: removes the next frame to send.
+ *
+ * Frames go out by priority, first-in first-out within a priority. Frames
+ * the filter rejects stay queued and are skipped, so a later frame that is
+ * allowed can go first.
+ *
+ * @param allow Filter, or NULL to accept any frame.
+ * @return tx_frame_t* Frame to transmit, or NULL if none is queued or allowed.
+ */
+tx_frame_t *tx_queue_next(tx_queue_filter_t allow);
+
+/**
+ * @brief Returns a frame to the pool once it has been sent or abandoned.
+ */
+void tx_queue_release(tx_frame_t *frame);
+
+/**
+ * @brief Returns true if a frame is waiting to be sent.
+ */
+bool tx_queue_pending(void);
+
+#endif /* TX_QUEUE_H */
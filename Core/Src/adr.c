@@ -0,0 +1,158 @@
+#include "adr.h"
+#include <string.h>
+
+static adr_link_t links[ADR_MAX_PEERS];
+static SX1272_ModemParams_t defaults;
+
+// Demodulation floor in 1/16 dB: -7.5 dB at SF7, 2.5 dB lower per SF step
+static int16_t adr_floor_q4(uint8_t sf) {
+    return -80 - (int16_t)(sf - 6) * 40;
+}
+
+static adr_link_t *adr_find(uint8_t peer, bool create) {
+    adr_link_t *free_link = NULL;
+
+    for (int i = 0; i < ADR_MAX_PEERS; i++) {
+        if (links[i].used && links[i].peer == peer) return &links[i];
+        if (!links[i].used && free_link == NULL) free_link = &links[i];
+    }
+    if (!create || free_link == NULL) return NULL;
+
+    memset(free_link, 0, sizeof(*free_link));
+    free_link->used = true;
+    free_link->peer = peer;
+    free_link->params = defaults;
+    free_link->previous = defaults;
+    return free_link;
+}
+
+static void adr_switch(adr_link_t *link, const SX1272_ModemParams_t *params, uint32_t now) {
+    link->previous = link->params;
+    link->params = *params;
+    link->requested = false;
+    link->probation = true;
+    link->since = now;
+    // Margins measured at the old parameters no longer apply
+    link->samples = 0;
+}
+
+static int8_t adr_clamp_power(int v) {
+    if (v < SX1272_POWER_MIN) return SX1272_POWER_MIN;
+    if (v > SX1272_POWER_MAX) return SX1272_POWER_MAX;
+    return (int8_t)v;
+}
+
+// One step along power -> SF -> CR, or back; false if the link is fine or at a limit
+static bool adr_step(const SX1272_ModemParams_t *cur, int16_t margin_q4, SX1272_ModemParams_t *next) {
+    *next = *cur;
+
+    if (margin_q4 < ADR_MARGIN_LOW_DB * 16) {
+        if (next->power < SX1272_POWER_MAX) next->power = adr_clamp_power(next->power + ADR_POWER_STEP_DB);
+        else if (next->sf < SX1272_SF_MAX) next->sf++;
+        else if (next->cr < SX1272_CR_4_8) next->cr++;
+        else return false;
+    } else if (margin_q4 > ADR_MARGIN_HIGH_DB * 16) {
+        if (next->cr > SX1272_CR_4_5) next->cr--;
+        else if (next->sf > SX1272_SF_MIN) next->sf--;
+        else if (next->power > SX1272_POWER_MIN) next->power = adr_clamp_power(next->power - ADR_POWER_STEP_DB);
+        else return false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void adr_init(const SX1272_ModemParams_t *initial) {
+    memset(links, 0, sizeof(links));
+    defaults = *initial;
+}
+
+void adr_record(uint8_t peer, int8_t snr, int16_t rssi) {
+    adr_link_t *link = adr_find(peer, true);
+    if (link == NULL) return;
+
+    // Only frames sent with the current parameters can be heard at all
+    link->probation = false;
+    link->rssi = rssi;
+
+    int16_t margin = (int16_t)snr * 16 - adr_floor_q4(link->params.sf);
+    if (link->samples == 0) {
+        link->margin_q4 = margin;
+    } else {
+        // EWMA with weight 1/8
+        link->margin_q4 += (margin - link->margin_q4) / 8;
+    }
+    if (link->samples < 255) link->samples++;
+}
+
+bool adr_evaluate(uint8_t peer, uint32_t now, SX1272_ModemParams_t *proposal) {
+    adr_link_t *link = adr_find(peer, false);
+    if (link == NULL || link->probation || link->samples < ADR_MIN_SAMPLES) return false;
+    if (link->requested && now - link->since < ADR_REQUEST_MS) return false;
+
+    if (!adr_step(&link->params, link->margin_q4, proposal)) return false;
+
+    link->requested = true;
+    link->since = now;
+    return true;
+}
+
+bool adr_handle_control(uint8_t peer, const uint8_t *payload, uint8_t len, uint32_t now,
+                        SX1272_ModemParams_t *apply, uint8_t *reply) {
+    *reply = 0;
+    if (len < ADR_PAYLOAD_SIZE) return false;
+
+    adr_link_t *link = adr_find(peer, true);
+    if (link == NULL) return false;
+
+    apply->sf = payload[1];
+    apply->cr = payload[2];
+    apply->power = (int8_t)payload[3];
+    if (apply->sf < SX1272_SF_MIN || apply->sf > SX1272_SF_MAX ||
+        apply->cr < SX1272_CR_4_5 || apply->cr > SX1272_CR_4_8) return false;
+
+    switch (payload[0]) {
+    case ADR_CMD_REQUEST:
+        *reply = ADR_CMD_ACCEPT;
+        adr_switch(link, apply, now);
+        return true;
+    case ADR_CMD_ACCEPT:
+        // Ignore stale or unsolicited accepts
+        if (!link->requested) return false;
+        adr_switch(link, apply, now);
+        return true;
+    default:
+        return false;
+    }
+}
+
+void adr_encode(uint8_t command, const SX1272_ModemParams_t *params, uint8_t *payload) {
+    payload[0] = command;
+    payload[1] = params->sf;
+    payload[2] = params->cr;
+    payload[3] = (uint8_t)params->power;
+}
+
+bool adr_tick(uint32_t now, SX1272_ModemParams_t *revert) {
+    for (int i = 0; i < ADR_MAX_PEERS; i++) {
+        adr_link_t *link = &links[i];
+        if (!link->used) continue;
+
+        if (link->requested && now - link->since >= ADR_REQUEST_MS) {
+            // No answer: decide again from fresh samples
+            link->requested = false;
+        }
+        if (link->probation && now - link->since >= ADR_REVERT_MS) {
+            link->params = link->previous;
+            link->probation = false;
+            link->samples = 0;
+            *revert = link->params;
+            return true;
+        }
+    }
+    return false;
+}
+
+const adr_link_t *adr_get_link(uint8_t peer) {
+    return adr_find(peer, false);
+}
@@ -11,7 +11,17 @@
 // Internal AES functions (simplified for 128-bit keys)
 static void aes_encrypt_block(const uint8_t *key, const uint8_t *in, uint8_t *out);
 static void gcm_multiply(uint8_t *x, const uint8_t *y);
-static void gcm_ghash(uint8_t *hash, const uint8_t *data, size_t len, const uint8_t *h);
+
+// GHASH state fed piece by piece, so AAD and ciphertext need no joint copy
+typedef struct {
+    uint8_t block[16];
+    size_t  fill;
+} gcm_ghash_t;
+
+static void gcm_ghash_update(gcm_ghash_t *g, const uint8_t *data, size_t len, const uint8_t *h);
+static void gcm_tag(const aes_gcm_ctx_t *ctx, const uint8_t *j0,
+                    const uint8_t *aad, uint32_t aad_len,
+                    const uint8_t *ciphertext, uint32_t ciphertext_len, uint8_t *tag);
 
 // AES S-box
 static const uint8_t sbox[256] = {
@@ -65,14 +75,35 @@ static void gcm_multiply(uint8_t *x, const uint8_t *y) {
     memcpy(x, z, 16);
 }
 
-// GCM GHASH function
-static void gcm_ghash(uint8_t *hash, const uint8_t *data, size_t len, const uint8_t *h) {
-    uint8_t block[16] = {0};
-    for (size_t i = 0; i < len; i += 16) {
-        for (int j = 0; j < 16 && i + j < len; j++) block[j] ^= data[i + j];
-        gcm_multiply(block, h);
+// GCM GHASH over the concatenation of everything fed so far. A partial
+// block carries over to the next call; the last one is zero padded.
+static void gcm_ghash_update(gcm_ghash_t *g, const uint8_t *data, size_t len, const uint8_t *h) {
+    for (size_t i = 0; i < len; i++) {
+        g->block[g->fill++] ^= data[i];
+        if (g->fill == 16) {
+            gcm_multiply(g->block, h);
+            g->fill = 0;
+        }
     }
-    memcpy(hash, block, 16);
+}
+
+// Tag = GHASH(AAD || ciphertext || lengths) ^ AES(J0)
+static void gcm_tag(const aes_gcm_ctx_t *ctx, const uint8_t *j0,
+                    const uint8_t *aad, uint32_t aad_len,
+                    const uint8_t *ciphertext, uint32_t ciphertext_len, uint8_t *tag) {
+    gcm_ghash_t g = { {0}, 0 };
+    uint64_t aad_len_bits = (uint64_t)aad_len * 8;
+    uint64_t ct_len_bits = (uint64_t)ciphertext_len * 8;
+    uint8_t encrypted_j0[16];
+
+    gcm_ghash_update(&g, aad, aad_len, ctx->h);
+    gcm_ghash_update(&g, ciphertext, ciphertext_len, ctx->h);
+    gcm_ghash_update(&g, (const uint8_t *)&aad_len_bits, 8, ctx->h);
+    gcm_ghash_update(&g, (const uint8_t *)&ct_len_bits, 8, ctx->h);
+    if (g.fill != 0) gcm_multiply(g.block, ctx->h);
+
+    aes_encrypt_block(ctx->key, j0, encrypted_j0);
+    for (int i = 0; i < 16; i++) tag[i] = g.block[i] ^ encrypted_j0[i];
 }
 
 /**
@@ -84,6 +115,25 @@ void aes_gcm_init(void) {
     // Nothing to initialize for software implementation
 }
 
+/**
+ * @brief Encrypts a single block with the raw block cipher.
+ */
+void aes_gcm_block_encrypt(const uint8_t *key, const uint8_t *in, uint8_t *out) {
+    aes_encrypt_block(key, in, out);
+}
+
+/**
+ * @brief Prepares a context for a key.
+ *
+ * Stores the key and computes the hash subkey H = AES(0^128) once, so it is
+ * not recomputed for every message.
+ */
+void aes_gcm_setkey(aes_gcm_ctx_t *ctx, const uint8_t *key) {
+    uint8_t zero[16] = {0};
+    memcpy(ctx->key, key, AES_KEY_SIZE);
+    aes_encrypt_block(ctx->key, zero, ctx->h);
+}
+
 /**
  * @brief Encrypts plaintext using software AES-GCM.
  * 
@@ -98,47 +148,46 @@ bool aes_gcm_encrypt(const uint8_t *key, const uint8_t *nonce,
                      const uint8_t *plaintext, uint32_t plaintext_len,
                      const uint8_t *aad, uint32_t aad_len,
                      uint8_t *ciphertext, uint8_t *tag) {
-    uint8_t h[16], j0[16], s[16] = {0}, ctr[16];
-    
-    // Step 1: Compute H = AES(0^128)
-    uint8_t zero[16] = {0};
-    aes_encrypt_block(key, zero, h);
+    aes_gcm_ctx_t ctx;
+    aes_gcm_setkey(&ctx, key);
+    return aes_gcm_encrypt_ctx(&ctx, nonce, plaintext, plaintext_len,
+                               aad, aad_len, ciphertext, tag);
+}
+
+/**
+ * @brief Encrypts plaintext with a prepared context.
+ *
+ * Same as aes_gcm_encrypt(), with step 1 already done by aes_gcm_setkey().
+ */
+bool aes_gcm_encrypt_ctx(const aes_gcm_ctx_t *ctx, const uint8_t *nonce,
+                         const uint8_t *plaintext, uint32_t plaintext_len,
+                         const uint8_t *aad, uint32_t aad_len,
+                         uint8_t *ciphertext, uint8_t *tag) {
+    const uint8_t *key = ctx->key;
+    uint8_t j0[16], ctr[16];
     
     // Step 2: Compute J0 = nonce || 0^31 || 1
+    memset(j0, 0, 16);
     memcpy(j0, nonce, 12);
     j0[15] = 1;
     
     // Step 3: CTR encryption
     memcpy(ctr, j0, 16);
+    uint8_t encrypted_ctr[16];
     for (uint32_t i = 0; i < plaintext_len; i++) {
         if (i % 16 == 0) {
-            uint8_t encrypted_ctr[16];
             aes_encrypt_block(key, ctr, encrypted_ctr);
             // Increment counter (big-endian)
             for (int j = 15; j >= 12; j--) {
                 if (++ctr[j] != 0) break;
             }
-            memcpy(ciphertext + i, encrypted_ctr, 16);
         }
-        ciphertext[i] ^= plaintext[i];
+        // XOR byte-wise so a short last block never writes past the output
+        ciphertext[i] = plaintext[i] ^ encrypted_ctr[i % 16];
     }
     
-    // Step 4: GHASH for AAD and ciphertext
-    uint8_t ghash_input[plaintext_len + aad_len + 16];
-    memcpy(ghash_input, aad, aad_len);
-    memcpy(ghash_input + aad_len, ciphertext, plaintext_len);
-    // Add length block
-    uint64_t aad_len_bits = aad_len * 8;
-    uint64_t pt_len_bits = plaintext_len * 8;
-    memcpy(ghash_input + aad_len + plaintext_len, &aad_len_bits, 8);
-    memcpy(ghash_input + aad_len + plaintext_len + 8, &pt_len_bits, 8);
-    
-    gcm_ghash(s, ghash_input, aad_len + plaintext_len + 16, h);
-    
-    // Step 5: Tag = GHASH ^ AES(J0)
-    uint8_t encrypted_j0[16];
-    aes_encrypt_block(key, j0, encrypted_j0);
-    for (int i = 0; i < 16; i++) tag[i] = s[i] ^ encrypted_j0[i];
+    // Step 4 and 5: GHASH for AAD and ciphertext, tag
+    gcm_tag(ctx, j0, aad, aad_len, ciphertext, plaintext_len, tag);
     
     return true;
 }
@@ -152,45 +201,44 @@ bool aes_gcm_decrypt(const uint8_t *key, const uint8_t *nonce,
                      const uint8_t *ciphertext, uint32_t ciphertext_len,
                      const uint8_t *aad, uint32_t aad_len,
                      const uint8_t *tag, uint8_t *plaintext) {
-    uint8_t h[16], j0[16], s[16] = {0}, ctr[16], computed_tag[16];
-    
-    // Compute H and J0 (same as encrypt)
-    uint8_t zero[16] = {0};
-    aes_encrypt_block(key, zero, h);
+    aes_gcm_ctx_t ctx;
+    aes_gcm_setkey(&ctx, key);
+    return aes_gcm_decrypt_ctx(&ctx, nonce, ciphertext, ciphertext_len,
+                               aad, aad_len, tag, plaintext);
+}
+
+/**
+ * @brief Decrypts and verifies with a prepared context.
+ */
+bool aes_gcm_decrypt_ctx(const aes_gcm_ctx_t *ctx, const uint8_t *nonce,
+                         const uint8_t *ciphertext, uint32_t ciphertext_len,
+                         const uint8_t *aad, uint32_t aad_len,
+                         const uint8_t *tag, uint8_t *plaintext) {
+    const uint8_t *key = ctx->key;
+    uint8_t j0[16], ctr[16], computed_tag[16];
+    
+    // Compute J0 (same as encrypt)
+    memset(j0, 0, 16);
     memcpy(j0, nonce, 12);
     j0[15] = 1;
     
-    // GHASH for AAD and ciphertext
-    uint8_t ghash_input[ciphertext_len + aad_len + 16];
-    memcpy(ghash_input, aad, aad_len);
-    memcpy(ghash_input + aad_len, ciphertext, ciphertext_len);
-    uint64_t aad_len_bits = aad_len * 8;
-    uint64_t ct_len_bits = ciphertext_len * 8;
-    memcpy(ghash_input + aad_len + ciphertext_len, &aad_len_bits, 8);
-    memcpy(ghash_input + aad_len + ciphertext_len + 8, &ct_len_bits, 8);
-    
-    gcm_ghash(s, ghash_input, aad_len + ciphertext_len + 16, h);
-    
-    // Computed tag
-    uint8_t encrypted_j0[16];
-    aes_encrypt_block(key, j0, encrypted_j0);
-    for (int i = 0; i < 16; i++) computed_tag[i] = s[i] ^ encrypted_j0[i];
+    // GHASH for AAD and ciphertext, computed tag
+    gcm_tag(ctx, j0, aad, aad_len, ciphertext, ciphertext_len, computed_tag);
     
     // Verify tag
     if (memcmp(computed_tag, tag, 16) != 0) return false;
     
     // CTR decryption (same as encryption)
     memcpy(ctr, j0, 16);
+    uint8_t encrypted_ctr[16];
     for (uint32_t i = 0; i < ciphertext_len; i++) {
         if (i % 16 == 0) {
-            uint8_t encrypted_ctr[16];
             aes_encrypt_block(key, ctr, encrypted_ctr);
             for (int j = 15; j >= 12; j--) {
                 if (++ctr[j] != 0) break;
             }
-            memcpy(plaintext + i, encrypted_ctr, 16);
         }
-        plaintext[i] ^= ciphertext[i];
+        plaintext[i] = ciphertext[i] ^ encrypted_ctr[i % 16];
     }
     
     return true;
@@ -0,0 +1,24 @@
+#include "airtime.h"
+
+uint32_t airtime_symbols_q4(const airtime_params_t *params, uint8_t payload_len) {
+    int32_t sf = params->sf;
+    int32_t num = 8 * (int32_t)payload_len - 4 * sf + 28 +
+                  (params->crc ? 16 : 0) - (params->implicit_header ? 20 : 0);
+    int32_t den = 4 * (sf - (params->ldro ? 2 : 0));
+    int32_t payload_symbols = 8;
+
+    // 8 + max(ceil(num / den) * (cr + 4), 0)
+    if (num > 0) {
+        payload_symbols += ((num + den - 1) / den) * (params->cr + 4);
+    }
+
+    return 4 * (uint32_t)params->preamble + 17 + 4 * (uint32_t)payload_symbols;
+}
+
+uint32_t airtime_us(const airtime_params_t *params, uint8_t payload_len) {
+    // T = symbols * 2^SF / BW
+    uint64_t num = (uint64_t)airtime_symbols_q4(params, payload_len) * (1UL << params->sf) * 1000000ULL;
+    uint64_t den = 4ULL * params->bw_hz;
+
+    return (uint32_t)((num + den - 1) / den);
+}
@@ -0,0 +1,322 @@
+#include "arq.h"
+#include "timer_wheel.h"
+#include <stddef.h>
+#include <string.h>
+
+#define ARQ_MASK          (ARQ_WINDOW_MAX - 1)
+// A base further ahead than this, or behind the receive window at all, is a restart
+#define ARQ_BASE_AHEAD    (2 * ARQ_WINDOW_MAX)
+
+typedef struct {
+    bool     used;
+    bool     due;            // To be (re)sent by arq_next()
+    uint8_t  retries;
+    uint8_t  len;
+    uint32_t sent_ms;
+    timer_wheel_timer_t timer;
+    uint8_t  data[ARQ_PAYLOAD_MAX];
+} arq_tx_slot_t;
+
+typedef struct {
+    bool     present;
+    uint8_t  seq;
+    uint8_t  len;
+    uint8_t  data[ARQ_PAYLOAD_MAX];
+} arq_rx_slot_t;
+
+#define ARQ_TX_SLOT_OF(t) ((arq_tx_slot_t *)((uint8_t *)(t) - offsetof(arq_tx_slot_t, timer)))
+
+static timer_wheel_t wheel;
+static timer_wheel_timer_t ackTimer;
+static bool ackDue;              // Owed; ackTimer waits for a reliable frame to carry it
+static bool ackNow;              // Owed and no longer waiting
+
+static arq_tx_slot_t txSlots[ARQ_WINDOW_MAX];
+static uint8_t window;
+static uint8_t txBase;           // Oldest frame not acknowledged or given up
+static uint8_t txNext;           // Next new sequence number
+
+static arq_rx_slot_t rxSlots[ARQ_WINDOW_MAX];
+static uint8_t rxBase;           // Oldest frame not handed to the application
+static uint8_t rxExpected;       // First frame not received
+static uint8_t rxPeerBase;       // Sender's base; frames before it will not come
+
+static bool rttValid;
+static uint32_t srtt;
+static uint32_t rttvar;
+static uint32_t rto;
+static arq_stats_t stats;
+
+static void arq_write_be16(uint8_t *out, uint16_t value) {
+    out[0] = (value >> 8) & 0xFF;
+    out[1] = value & 0xFF;
+}
+
+static uint16_t arq_read_be16(const uint8_t *in) {
+    return ((uint16_t)in[0] << 8) | in[1];
+}
+
+// 1..max steps from 'from' to 'to' in sequence space
+static bool arq_ahead(uint8_t from, uint8_t to, uint8_t max) {
+    uint8_t distance = to - from;
+    return distance != 0 && distance <= max;
+}
+
+static bool arq_rx_has(uint8_t seq) {
+    const arq_rx_slot_t *slot = &rxSlots[seq & ARQ_MASK];
+    return (uint8_t)(seq - rxBase) < ARQ_WINDOW_MAX && slot->present && slot->seq == seq;
+}
+
+// | base | ack | bitmap |
+static void arq_write_ack(uint8_t *out) {
+    uint16_t bitmap = 0;
+
+    for (int i = 0; i < 16; i++) {
+        if (arq_rx_has(rxExpected + 1 + i)) bitmap |= 1U << i;
+    }
+    out[0] = txBase;
+    out[1] = rxExpected;
+    arq_write_be16(out + 2, bitmap);
+
+    ackDue = false;
+    ackNow = false;
+    timer_wheel_stop(&ackTimer);
+}
+
+static void arq_ack_owed(void) {
+    if (!ackDue) {
+        ackDue = true;
+        timer_wheel_start(&wheel, &ackTimer, ARQ_ACK_DELAY_MS);
+    }
+}
+
+// RFC 6298 with G = ARQ_TICK_MS
+static void arq_rtt_sample(uint32_t rtt) {
+    if (!rttValid) {
+        srtt = rtt;
+        rttvar = rtt / 2;
+        rttValid = true;
+    } else {
+        uint32_t delta = (srtt > rtt) ? srtt - rtt : rtt - srtt;
+        rttvar = (3 * rttvar + delta) / 4;
+        srtt = (7 * srtt + rtt) / 8;
+    }
+    rto = srtt + ((4 * rttvar > ARQ_TICK_MS) ? 4 * rttvar : ARQ_TICK_MS);
+    if (rto < ARQ_RTO_MIN_MS) rto = ARQ_RTO_MIN_MS;
+    if (rto > ARQ_RTO_MAX_MS) rto = ARQ_RTO_MAX_MS;
+    stats.srtt_ms = srtt;
+    stats.rto_ms = rto;
+}
+
+static void arq_tx_slide(void) {
+    while (txBase != txNext && !txSlots[txBase & ARQ_MASK].used) txBase++;
+}
+
+static void arq_tx_ack(uint8_t seq, uint32_t now) {
+    arq_tx_slot_t *slot = &txSlots[seq & ARQ_MASK];
+
+    if ((uint8_t)(seq - txBase) >= (uint8_t)(txNext - txBase) || !slot->used) return;
+    // Never sent: nothing the peer can have seen
+    if (slot->due && slot->retries == 0) return;
+
+    // Karn: a frame sent more than once gives no clean sample
+    if (slot->retries == 0) arq_rtt_sample(now - slot->sent_ms);
+    timer_wheel_stop(&slot->timer);
+    slot->used = false;
+    stats.acked++;
+}
+
+static void arq_on_ack(const uint8_t *ack, uint32_t now) {
+    uint8_t cumulative = ack[1];
+    uint16_t bitmap = arq_read_be16(ack + 2);
+
+    // Stale or foreign cumulative acks fall outside the frames in flight
+    if ((uint8_t)(cumulative - txBase) <= (uint8_t)(txNext - txBase)) {
+        for (uint8_t seq = txBase; seq != cumulative; seq++) arq_tx_ack(seq, now);
+    }
+    for (int i = 0; i < 16; i++) {
+        if (bitmap & (1U << i)) arq_tx_ack(cumulative + 1 + i, now);
+    }
+    arq_tx_slide();
+}
+
+// Moves rxExpected over received frames and over gaps the sender gave up
+static void arq_rx_advance(void) {
+    while ((uint8_t)(rxExpected - rxBase) < ARQ_WINDOW_MAX) {
+        if (arq_rx_has(rxExpected)) {
+            rxExpected++;
+        } else if (arq_ahead(rxExpected, rxPeerBase, ARQ_BASE_AHEAD)) {
+            rxSlots[rxExpected & ARQ_MASK].present = false;
+            rxExpected++;
+            stats.skipped++;
+        } else {
+            break;
+        }
+    }
+    // Once passed, the old base must not look ahead again after the wrap
+    if (!arq_ahead(rxExpected, rxPeerBase, ARQ_BASE_AHEAD)) rxPeerBase = rxExpected;
+}
+
+static void arq_rx_resync(uint8_t base) {
+    for (int i = 0; i < ARQ_WINDOW_MAX; i++) rxSlots[i].present = false;
+    rxBase = base;
+    rxExpected = base;
+    rxPeerBase = base;
+    stats.resyncs++;
+}
+
+static void arq_on_base(uint8_t base) {
+    if (base == rxExpected) return;
+    if (arq_ahead(rxExpected, base, ARQ_BASE_AHEAD)) {
+        rxPeerBase = base;
+        arq_rx_advance();
+    } else if (!arq_ahead(base, rxExpected, ARQ_WINDOW_MAX)) {
+        // Not a late frame from before our last ack: the peer started over
+        arq_rx_resync(base);
+    }
+}
+
+static void arq_on_data(uint8_t seq, const uint8_t *data, uint8_t len) {
+    arq_rx_slot_t *slot = &rxSlots[seq & ARQ_MASK];
+
+    if (arq_ahead(seq, rxExpected, ARQ_BASE_AHEAD) || arq_rx_has(seq)) {
+        // Our ack got lost: repeat it
+        stats.duplicates++;
+        arq_ack_owed();
+        return;
+    }
+    // No room while the application holds earlier frames; the sender retries
+    if ((uint8_t)(seq - rxBase) >= ARQ_WINDOW_MAX || len > ARQ_PAYLOAD_MAX) return;
+
+    slot->present = true;
+    slot->seq = seq;
+    slot->len = len;
+    memcpy(slot->data, data, len);
+    stats.received++;
+
+    arq_rx_advance();
+    arq_ack_owed();
+}
+
+void arq_init(uint8_t frames, uint32_t now) {
+    window = (frames == 0) ? 1 : (frames > ARQ_WINDOW_MAX) ? ARQ_WINDOW_MAX : frames;
+
+    timer_wheel_init(&wheel, ARQ_TICK_MS, now);
+    memset(&ackTimer, 0, sizeof(ackTimer));
+    memset(txSlots, 0, sizeof(txSlots));
+    memset(rxSlots, 0, sizeof(rxSlots));
+    memset(&stats, 0, sizeof(stats));
+    ackDue = false;
+    ackNow = false;
+    txBase = txNext = 0;
+    rxBase = rxExpected = rxPeerBase = 0;
+
+    rttValid = false;
+    srtt = 0;
+    rttvar = 0;
+    rto = ARQ_RTO_INIT_MS;
+    stats.rto_ms = rto;
+}
+
+bool arq_send(const uint8_t *data, uint8_t len) {
+    arq_tx_slot_t *slot = &txSlots[txNext & ARQ_MASK];
+
+    if (len > ARQ_PAYLOAD_MAX || arq_window_free() == 0) return false;
+
+    memcpy(slot->data, data, len);
+    slot->len = len;
+    slot->retries = 0;
+    slot->due = true;
+    slot->used = true;
+    txNext++;
+    return true;
+}
+
+uint8_t arq_window_free(void) {
+    return window - (uint8_t)(txNext - txBase);
+}
+
+uint8_t arq_next(uint8_t *type, uint8_t *payload, uint32_t now) {
+    for (uint8_t seq = txBase; seq != txNext; seq++) {
+        arq_tx_slot_t *slot = &txSlots[seq & ARQ_MASK];
+        uint32_t timeout;
+
+        if (!slot->used || !slot->due) continue;
+
+        payload[0] = seq;
+        arq_write_ack(payload + 1);
+        memcpy(payload + ARQ_HEADER_SIZE, slot->data, slot->len);
+
+        if (slot->retries == 0) stats.sent++;
+        else stats.retransmitted++;
+        slot->due = false;
+        slot->sent_ms = now;
+        timeout = rto << slot->retries;
+        timer_wheel_start(&wheel, &slot->timer, (timeout > ARQ_RTO_MAX_MS) ? ARQ_RTO_MAX_MS : timeout);
+
+        *type = FRAME_TYPE_ARQ;
+        return ARQ_HEADER_SIZE + slot->len;
+    }
+
+    if (ackNow) {
+        arq_write_ack(payload);
+        stats.acks_sent++;
+        *type = FRAME_TYPE_ARQ_ACK;
+        return ARQ_ACK_SIZE;
+    }
+    return 0;
+}
+
+void arq_on_frame(uint8_t type, const uint8_t *payload, uint8_t len, uint32_t now) {
+    if (type == FRAME_TYPE_ARQ && len >= ARQ_HEADER_SIZE) {
+        arq_on_ack(payload + 1, now);
+        arq_on_base(payload[1]);
+        arq_on_data(payload[0], payload + ARQ_HEADER_SIZE, len - ARQ_HEADER_SIZE);
+    } else if (type == FRAME_TYPE_ARQ_ACK && len >= ARQ_ACK_SIZE) {
+        arq_on_ack(payload, now);
+        arq_on_base(payload[0]);
+    }
+}
+
+void arq_tick(uint32_t now) {
+    timer_wheel_timer_t *timer;
+
+    while ((timer = timer_wheel_expire(&wheel, now)) != NULL) {
+        if (timer == &ackTimer) {
+            ackNow = true;
+            continue;
+        }
+
+        arq_tx_slot_t *slot = ARQ_TX_SLOT_OF(timer);
+        if (++slot->retries > ARQ_RETRY_MAX) {
+            // Give up; the next ack we send tells the peer to skip it
+            slot->used = false;
+            stats.failed++;
+            arq_tx_slide();
+            ackNow = true;
+        } else {
+            slot->due = true;
+        }
+    }
+}
+
+const uint8_t *arq_peek(uint8_t *len) {
+    // Skipped gaps are not handed out
+    while (rxBase != rxExpected && !arq_rx_has(rxBase)) rxBase++;
+    if (rxBase == rxExpected) return NULL;
+
+    *len = rxSlots[rxBase & ARQ_MASK].len;
+    return rxSlots[rxBase & ARQ_MASK].data;
+}
+
+void arq_release(void) {
+    if (rxBase == rxExpected) return;
+    rxSlots[rxBase & ARQ_MASK].present = false;
+    rxBase++;
+    // Room for frames the sender gave up on past the old window end
+    arq_rx_advance();
+}
+
+const arq_stats_t *arq_get_stats(void) {
+    return &stats;
+}
@@ -0,0 +1,49 @@
+#include "channel_plan.h"
+
+#define CHANNEL_ENTRY(hz) \
+    { (CHANNEL_FRF(hz) >> 16) & 0xFF, (CHANNEL_FRF(hz) >> 8) & 0xFF, CHANNEL_FRF(hz) & 0xFF }
+
+// Three 868.x channels in h1.5 and five 867.x channels in h1.4, all 1 %
+static const uint32_t channelFreq[CHANNEL_COUNT] = {
+    868100000, 868300000, 868500000,
+    867100000, 867300000, 867500000, 867700000, 867900000,
+};
+
+static const uint8_t channelFrf[CHANNEL_COUNT][3] = {
+    CHANNEL_ENTRY(868100000), CHANNEL_ENTRY(868300000), CHANNEL_ENTRY(868500000),
+    CHANNEL_ENTRY(867100000), CHANNEL_ENTRY(867300000), CHANNEL_ENTRY(867500000),
+    CHANNEL_ENTRY(867700000), CHANNEL_ENTRY(867900000),
+};
+
+static uint8_t sequence[CHANNEL_COUNT];
+
+void channel_plan_init(uint32_t seed) {
+    uint32_t state = seed ? seed : 0x9E3779B9;
+
+    for (uint8_t i = 0; i < CHANNEL_COUNT; i++) {
+        sequence[i] = i;
+    }
+    // Fisher-Yates shuffle driven by xorshift32: every channel once per cycle
+    for (uint8_t i = CHANNEL_COUNT - 1; i > 0; i--) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+
+        uint8_t j = state % (i + 1);
+        uint8_t tmp = sequence[i];
+        sequence[i] = sequence[j];
+        sequence[j] = tmp;
+    }
+}
+
+uint8_t channel_plan_hop(uint32_t hop) {
+    return sequence[hop % CHANNEL_COUNT];
+}
+
+const uint8_t *channel_plan_frf(uint8_t channel) {
+    return channelFrf[channel % CHANNEL_COUNT];
+}
+
+uint32_t channel_plan_freq(uint8_t channel) {
+    return channelFreq[channel % CHANNEL_COUNT];
+}
@@ -0,0 +1,86 @@
+#include "duty.h"
+#include <string.h>
+
+static const duty_band_t bands[] = {
+    { 863000000, 865000000, 1000 },   // h1.3  0.1 %
+    { 865000000, 868000000,  100 },   // h1.4  1 %
+    { 868000000, 868600000,  100 },   // h1.5  1 %
+    { 868700000, 869200000, 1000 },   // h1.6  0.1 %
+    { 869400000, 869650000,   10 },   // h1.7  10 %
+    { 869700000, 870000000,  100 },   // h1.9  1 %
+};
+#define DUTY_BAND_COUNT (sizeof(bands) / sizeof(bands[0]))
+
+// One bucket more than the window so a partial slot at each end is covered
+static uint32_t used[DUTY_BAND_COUNT][DUTY_SLOTS + 1];
+static uint8_t current;
+static uint32_t slotStart;
+
+// Moves the current bucket forward to now, clearing the buckets it passes
+static void duty_advance(uint32_t now) {
+    uint32_t steps = 0;
+
+    while (now - slotStart >= DUTY_SLOT_MS) {
+        slotStart += DUTY_SLOT_MS;
+        current = (current + 1) % (DUTY_SLOTS + 1);
+        for (uint32_t b = 0; b < DUTY_BAND_COUNT; b++) {
+            used[b][current] = 0;
+        }
+        // After a full turn everything is clear; skip ahead
+        if (++steps > DUTY_SLOTS) {
+            slotStart += ((now - slotStart) / DUTY_SLOT_MS) * DUTY_SLOT_MS;
+        }
+    }
+}
+
+static uint32_t duty_sum(uint32_t b) {
+    uint32_t sum = 0;
+    for (int i = 0; i <= DUTY_SLOTS; i++) {
+        sum += used[b][i];
+    }
+    return sum;
+}
+
+void duty_init(uint32_t now) {
+    memset(used, 0, sizeof(used));
+    current = 0;
+    slotStart = now;
+}
+
+const duty_band_t *duty_band(uint32_t freq_hz, uint32_t bw_hz) {
+    uint32_t half = bw_hz / 2;
+
+    for (uint32_t b = 0; b < DUTY_BAND_COUNT; b++) {
+        if (freq_hz - half >= bands[b].lo_hz && freq_hz + half <= bands[b].hi_hz) {
+            return &bands[b];
+        }
+    }
+    return NULL;
+}
+
+bool duty_allows(uint32_t freq_hz, uint32_t bw_hz, uint32_t airtime_us, uint32_t now) {
+    const duty_band_t *band = duty_band(freq_hz, bw_hz);
+    if (band == NULL) return false;
+
+    uint32_t budget = (uint32_t)(DUTY_WINDOW_MS * 1000ULL / band->divisor);
+    uint32_t spent = duty_used_us(band, now);
+    return spent <= budget && airtime_us <= budget - spent;
+}
+
+void duty_record(uint32_t freq_hz, uint32_t bw_hz, uint32_t airtime_us, uint32_t now) {
+    const duty_band_t *band = duty_band(freq_hz, bw_hz);
+    if (band == NULL) return;
+
+    duty_advance(now);
+    used[band - bands][current] += airtime_us;
+}
+
+uint32_t duty_next_change(uint32_t now) {
+    duty_advance(now);
+    return DUTY_SLOT_MS - (now - slotStart);
+}
+
+uint32_t duty_used_us(const duty_band_t *band, uint32_t now) {
+    duty_advance(now);
+    return duty_sum(band - bands);
+}
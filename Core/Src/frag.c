@@ -0,0 +1,376 @@
+#include "frag.h"
+#include <string.h>
+
+#define FRAG_OFF_INDEX   (FRAME_HEADER_SIZE + 0)
+#define FRAG_OFF_COUNT   (FRAME_HEADER_SIZE + 1)
+#define FRAG_OFF_CHUNK   (FRAME_HEADER_SIZE + 2)
+#define FRAG_OFF_DATA    (FRAME_HEADER_SIZE + FRAG_HEADER_SIZE)
+#define FRAG_AAD_SIZE    (FRAME_HEADER_SIZE + 2)
+
+typedef enum {
+    FRAG_SLOT_FREE = 0,
+    FRAG_SLOT_COLLECTING,
+    FRAG_SLOT_COMPLETE,     // All fragments in, not authenticated yet
+    FRAG_SLOT_OPEN,         // Plaintext held for the application
+    FRAG_SLOT_DONE          // Released; kept only to repeat the acknowledgement
+} frag_slot_state_t;
+
+typedef struct {
+    uint8_t  state;
+    bool     status_due;
+    uint8_t  count;
+    uint8_t  chunk;
+    uint16_t length;        // Ciphertext and tag, known once the final fragment is in
+    uint32_t received;
+    uint32_t progress_ms;   // Last new fragment
+    uint32_t status_ms;     // Last new fragment or status sent
+    lora_frame_header_t header;
+    uint8_t  data[FRAG_BUFFER_SIZE];
+} frag_slot_t;
+
+static struct {
+    frag_tx_state_t state;
+    uint8_t  count;
+    uint8_t  chunk;
+    uint8_t  rounds;
+    uint16_t length;
+    uint32_t pending;
+    uint32_t sent_ms;       // Last fragment handed out or status applied
+    lora_frame_header_t header;
+    uint8_t  data[FRAG_BUFFER_SIZE];
+} tx;
+
+static frag_slot_t slots[FRAG_RX_SLOTS];
+static frag_stats_t stats;
+static uint32_t fragNow;
+
+static uint32_t frag_all(uint8_t count) {
+    return (count >= 32) ? 0xFFFFFFFFUL : ((1UL << count) - 1);
+}
+
+// Frame header as sent, followed by count and chunk
+static void frag_build_aad(const lora_frame_header_t *header, uint8_t count, uint8_t chunk, uint8_t *aad) {
+    lora_frame_write_header(header, aad);
+    aad[FRAME_HEADER_SIZE] = count;
+    aad[FRAME_HEADER_SIZE + 1] = chunk;
+}
+
+static bool frag_same_message(const lora_frame_header_t *a, const lora_frame_header_t *b) {
+    return a->net_id == b->net_id && a->src == b->src &&
+           a->key_hint == b->key_hint && a->counter == b->counter;
+}
+
+static void frag_write_be32(uint8_t *out, uint32_t value) {
+    out[0] = (value >> 24) & 0xFF;
+    out[1] = (value >> 16) & 0xFF;
+    out[2] = (value >> 8) & 0xFF;
+    out[3] = value & 0xFF;
+}
+
+static uint32_t frag_read_be32(const uint8_t *in) {
+    return ((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) |
+           ((uint32_t)in[2] << 8) | (uint32_t)in[3];
+}
+
+void frag_init(void) {
+    memset(&tx, 0, sizeof(tx));
+    memset(slots, 0, sizeof(slots));
+    memset(&stats, 0, sizeof(stats));
+}
+
+void frag_tick(uint32_t now) {
+    fragNow = now;
+
+    // Nothing heard since the last fragment: repeat it so the receiver answers
+    if (tx.state == FRAG_TX_WAITING && now - tx.sent_ms >= FRAG_TX_POLL_MS) {
+        if (++tx.rounds > FRAG_TX_ROUNDS) {
+            tx.state = FRAG_TX_FAILED;
+            stats.tx_failed++;
+        } else {
+            tx.pending = 1UL << (tx.count - 1);
+            tx.state = FRAG_TX_SENDING;
+            stats.tx_repeats++;
+        }
+    }
+
+    for (int i = 0; i < FRAG_RX_SLOTS; i++) {
+        frag_slot_t *slot = &slots[i];
+
+        if (slot->state != FRAG_SLOT_COLLECTING && slot->state != FRAG_SLOT_COMPLETE) continue;
+        if (now - slot->progress_ms >= FRAG_RX_TIMEOUT_MS) {
+            slot->state = FRAG_SLOT_FREE;
+            slot->status_due = false;
+            stats.rx_dropped++;
+        } else if (slot->state == FRAG_SLOT_COLLECTING && now - slot->status_ms >= FRAG_STATUS_MS) {
+            slot->status_due = true;
+        }
+    }
+}
+
+uint8_t frag_tx_start(const aes_gcm_ctx_t *ctx, const lora_frame_header_t *header,
+                      const uint8_t *message, uint16_t length, uint8_t max_frame) {
+    uint8_t nonce[GCM_NONCE_SIZE];
+    uint8_t aad[FRAG_AAD_SIZE];
+    uint16_t total = length + GCM_TAG_SIZE;
+    uint16_t chunk = max_frame - FRAG_OFF_DATA;
+    uint16_t count;
+
+    tx.state = FRAG_TX_IDLE;
+    if (length > FRAG_MESSAGE_MAX || max_frame < FRAG_OFF_DATA + FRAG_CHUNK_MIN) return 0;
+
+    count = (total + chunk - 1) / chunk;
+    if (count > FRAG_MAX_FRAGMENTS) return 0;
+    // Same count, evenly filled: no short tail fragment
+    chunk = (total + count - 1) / count;
+    if (chunk < FRAG_CHUNK_MIN) chunk = FRAG_CHUNK_MIN;
+
+    tx.header = *header;
+    tx.header.type = FRAME_TYPE_FRAGMENT;
+    tx.count = count;
+    tx.chunk = chunk;
+    tx.length = total;
+
+    // One nonce, one tag for the whole message
+    lora_frame_build_nonce(&tx.header, nonce);
+    frag_build_aad(&tx.header, tx.count, tx.chunk, aad);
+    aes_gcm_encrypt_ctx(ctx, nonce, message, length, aad, sizeof(aad),
+                        tx.data, tx.data + length);
+
+    tx.pending = frag_all(tx.count);
+    tx.rounds = 0;
+    tx.state = FRAG_TX_SENDING;
+    stats.tx_messages++;
+    return tx.count;
+}
+
+uint8_t frag_tx_next(uint8_t *frame) {
+    uint8_t index;
+    uint16_t offset, size;
+
+    if (tx.state != FRAG_TX_SENDING || tx.pending == 0) return 0;
+
+    index = __builtin_ctz(tx.pending);
+    offset = (uint16_t)index * tx.chunk;
+    size = (tx.length - offset < tx.chunk) ? tx.length - offset : tx.chunk;
+
+    lora_frame_write_header(&tx.header, frame);
+    frame[FRAG_OFF_INDEX] = index;
+    frame[FRAG_OFF_COUNT] = tx.count;
+    frame[FRAG_OFF_CHUNK] = tx.chunk;
+    memcpy(frame + FRAG_OFF_DATA, tx.data + offset, size);
+
+    tx.pending &= ~(1UL << index);
+    if (tx.pending == 0) {
+        tx.state = FRAG_TX_WAITING;
+        tx.sent_ms = fragNow;
+    }
+    stats.tx_fragments++;
+    return FRAG_OFF_DATA + size;
+}
+
+void frag_tx_status(const uint8_t *payload, uint8_t len) {
+    uint32_t missing;
+
+    if (len < FRAG_STATUS_SIZE) return;
+    if (tx.state != FRAG_TX_SENDING && tx.state != FRAG_TX_WAITING) return;
+    if (frag_read_be32(payload) != tx.header.counter) return;
+
+    missing = frag_read_be32(payload + 4) & frag_all(tx.count);
+    if (missing == 0) {
+        tx.state = FRAG_TX_DONE;
+        return;
+    }
+
+    // Fragments still pending from an earlier round are not repeats
+    missing &= ~tx.pending;
+    if (missing == 0) return;
+    if (++tx.rounds > FRAG_TX_ROUNDS) {
+        tx.state = FRAG_TX_FAILED;
+        stats.tx_failed++;
+        return;
+    }
+    tx.pending |= missing;
+    tx.state = FRAG_TX_SENDING;
+    tx.sent_ms = fragNow;
+    stats.tx_repeats += __builtin_popcount(missing);
+}
+
+frag_tx_state_t frag_tx_state(void) {
+    return tx.state;
+}
+
+bool frag_tx_busy(void) {
+    return tx.state == FRAG_TX_SENDING || tx.state == FRAG_TX_WAITING;
+}
+
+static frag_slot_t *frag_find(const lora_frame_header_t *header) {
+    for (int i = 0; i < FRAG_RX_SLOTS; i++) {
+        if (slots[i].state != FRAG_SLOT_FREE && frag_same_message(&slots[i].header, header)) {
+            return &slots[i];
+        }
+    }
+    return NULL;
+}
+
+static frag_slot_t *frag_alloc(void) {
+    frag_slot_t *done = NULL;
+
+    // Prefer a free slot, then one only kept for a repeat acknowledgement
+    for (int i = 0; i < FRAG_RX_SLOTS; i++) {
+        if (slots[i].state == FRAG_SLOT_FREE) return &slots[i];
+        if (slots[i].state == FRAG_SLOT_DONE && !slots[i].status_due) done = &slots[i];
+    }
+    return done;
+}
+
+bool frag_rx_add(const lora_frame_header_t *header, const uint8_t *frame, uint8_t frame_len) {
+    uint8_t index, count, chunk, size;
+    uint16_t offset;
+    frag_slot_t *slot;
+
+    stats.rx_fragments++;
+    if (frame_len < FRAG_FRAME_MIN) {
+        stats.rx_dropped++;
+        return false;
+    }
+
+    index = frame[FRAG_OFF_INDEX];
+    count = frame[FRAG_OFF_COUNT];
+    chunk = frame[FRAG_OFF_CHUNK];
+    size = frame_len - FRAG_OFF_DATA;
+    offset = (uint16_t)index * chunk;
+
+    // Only the final fragment may be short, and the message must fit the pool
+    if (count == 0 || count > FRAG_MAX_FRAGMENTS || index >= count || chunk < FRAG_CHUNK_MIN ||
+        size > chunk || (index != count - 1 && size != chunk) ||
+        (uint32_t)(count - 1) * chunk + GCM_TAG_SIZE > FRAG_BUFFER_SIZE ||
+        offset + size > FRAG_BUFFER_SIZE) {
+        stats.rx_dropped++;
+        return false;
+    }
+
+    slot = frag_find(header);
+    if (slot != NULL && slot->state != FRAG_SLOT_COLLECTING) {
+        // Already complete: the sender still waits for our status
+        stats.rx_duplicates++;
+        slot->status_due = (slot->state != FRAG_SLOT_COMPLETE);
+        return false;
+    }
+    if (slot != NULL && (slot->count != count || slot->chunk != chunk)) {
+        stats.rx_dropped++;
+        return false;
+    }
+    if (slot == NULL) {
+        slot = frag_alloc();
+        if (slot == NULL) {
+            stats.rx_dropped++;
+            return false;
+        }
+        slot->state = FRAG_SLOT_COLLECTING;
+        slot->status_due = false;
+        slot->count = count;
+        slot->chunk = chunk;
+        slot->length = 0;
+        slot->received = 0;
+        slot->header = *header;
+    }
+
+    if (slot->received & (1UL << index)) {
+        // A repeated fragment means the sender is waiting for a status
+        stats.rx_duplicates++;
+        slot->status_due = true;
+        return false;
+    }
+
+    memcpy(slot->data + offset, frame + FRAG_OFF_DATA, size);
+    slot->received |= 1UL << index;
+    slot->progress_ms = fragNow;
+    slot->status_ms = fragNow;
+    if (index == count - 1) slot->length = offset + size;
+
+    if (slot->received == frag_all(count)) {
+        slot->state = FRAG_SLOT_COMPLETE;
+        slot->status_due = false;
+        return true;
+    }
+    // The sender has reached the end: ask for the gaps right away
+    if (index == count - 1) slot->status_due = true;
+    return false;
+}
+
+bool frag_rx_open(const aes_gcm_ctx_t *ctx, const lora_frame_header_t *header) {
+    uint8_t nonce[GCM_NONCE_SIZE];
+    uint8_t aad[FRAG_AAD_SIZE];
+    frag_slot_t *slot = frag_find(header);
+    uint16_t length;
+
+    if (slot == NULL || slot->state != FRAG_SLOT_COMPLETE) return false;
+
+    if (slot->length < GCM_TAG_SIZE) {
+        slot->state = FRAG_SLOT_FREE;
+        stats.rx_dropped++;
+        return false;
+    }
+    length = slot->length - GCM_TAG_SIZE;
+
+    // Decrypt in place, the plaintext replaces the ciphertext in the slot
+    lora_frame_build_nonce(&slot->header, nonce);
+    frag_build_aad(&slot->header, slot->count, slot->chunk, aad);
+    if (!aes_gcm_decrypt_ctx(ctx, nonce, slot->data, length, aad, sizeof(aad),
+                             slot->data + length, slot->data)) {
+        slot->state = FRAG_SLOT_FREE;
+        stats.rx_auth_failed++;
+        return false;
+    }
+
+    slot->state = FRAG_SLOT_OPEN;
+    slot->status_due = true;
+    stats.rx_messages++;
+    return true;
+}
+
+const uint8_t *frag_rx_message(const lora_frame_header_t *header, uint16_t *length) {
+    frag_slot_t *slot = frag_find(header);
+
+    if (slot == NULL || slot->state != FRAG_SLOT_OPEN) return NULL;
+    *length = slot->length - GCM_TAG_SIZE;
+    return slot->data;
+}
+
+void frag_rx_release(const lora_frame_header_t *header) {
+    frag_slot_t *slot = frag_find(header);
+
+    if (slot != NULL && slot->state == FRAG_SLOT_OPEN) slot->state = FRAG_SLOT_DONE;
+}
+
+void frag_rx_replayed(const lora_frame_header_t *header) {
+    frag_slot_t *slot = frag_find(header);
+
+    if (slot != NULL && (slot->state == FRAG_SLOT_OPEN || slot->state == FRAG_SLOT_DONE)) {
+        slot->status_due = true;
+    }
+}
+
+bool frag_rx_status(uint8_t *peer, uint8_t *payload) {
+    for (int i = 0; i < FRAG_RX_SLOTS; i++) {
+        frag_slot_t *slot = &slots[i];
+        uint32_t missing = 0;
+
+        if (!slot->status_due) continue;
+        if (slot->state == FRAG_SLOT_COLLECTING) {
+            missing = frag_all(slot->count) & ~slot->received;
+        }
+        frag_write_be32(payload, slot->header.counter);
+        frag_write_be32(payload + 4, missing);
+        *peer = slot->header.src;
+
+        slot->status_due = false;
+        slot->status_ms = fragNow;
+        return true;
+    }
+    return false;
+}
+
+const frag_stats_t *frag_get_stats(void) {
+    return &stats;
+}
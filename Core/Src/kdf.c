@@ -0,0 +1,131 @@
+#include "kdf.h"
+#include <string.h>
+
+typedef struct {
+    bool          valid;
+    uint32_t      epoch;
+    uint32_t      last_used;
+    aes_gcm_ctx_t ctx;
+} kdf_cache_entry_t;
+
+static uint8_t kdf_master[AES_KEY_SIZE];
+static uint8_t kdf_k1[16];
+static uint8_t kdf_k2[16];
+static uint8_t kdf_label;
+
+static kdf_cache_entry_t kdf_cache[KDF_CACHE_SIZE];
+static uint32_t kdf_clock;
+static kdf_stats_t kdf_stats;
+
+// Doubling in GF(2^128) used for the CMAC subkeys
+static void kdf_gf_double(const uint8_t *in, uint8_t *out) {
+    uint8_t carry = in[0] & 0x80;
+    for (int i = 0; i < 15; i++) {
+        out[i] = (uint8_t)((in[i] << 1) | (in[i + 1] >> 7));
+    }
+    out[15] = (uint8_t)(in[15] << 1);
+    if (carry) out[15] ^= 0x87;
+}
+
+// AES-CMAC over a message shorter than one block, which is all the KDF needs
+static void kdf_cmac_short(const uint8_t *msg, uint32_t len, uint8_t *mac) {
+    uint8_t block[16] = {0};
+
+    memcpy(block, msg, len);
+    if (len == 16) {
+        for (int i = 0; i < 16; i++) block[i] ^= kdf_k1[i];
+    } else {
+        block[len] = 0x80;
+        for (int i = 0; i < 16; i++) block[i] ^= kdf_k2[i];
+    }
+    aes_gcm_block_encrypt(kdf_master, block, mac);
+}
+
+void kdf_init(const uint8_t *master_key, uint8_t label) {
+    uint8_t zero[16] = {0};
+    uint8_t l[16];
+
+    memcpy(kdf_master, master_key, AES_KEY_SIZE);
+    kdf_label = label;
+
+    aes_gcm_block_encrypt(kdf_master, zero, l);
+    kdf_gf_double(l, kdf_k1);
+    kdf_gf_double(kdf_k1, kdf_k2);
+
+    memset(kdf_cache, 0, sizeof(kdf_cache));
+    memset(&kdf_stats, 0, sizeof(kdf_stats));
+    kdf_clock = 0;
+}
+
+void kdf_derive_key(uint32_t epoch, uint8_t *key) {
+    uint8_t msg[9];
+
+    msg[0] = 0x01;                  // Counter i, one block of output
+    msg[1] = kdf_label;
+    msg[2] = 0x00;                  // Separator
+    msg[3] = (epoch >> 24) & 0xFF;  // Context
+    msg[4] = (epoch >> 16) & 0xFF;
+    msg[5] = (epoch >> 8) & 0xFF;
+    msg[6] = epoch & 0xFF;
+    msg[7] = 0x00;                  // L = 128 bits
+    msg[8] = 0x80;
+
+    kdf_cmac_short(msg, sizeof(msg), key);
+}
+
+static kdf_cache_entry_t *kdf_cache_find(uint32_t epoch) {
+    for (uint32_t i = 0; i < KDF_CACHE_SIZE; i++) {
+        if (kdf_cache[i].valid && kdf_cache[i].epoch == epoch) {
+            return &kdf_cache[i];
+        }
+    }
+    return NULL;
+}
+
+static kdf_cache_entry_t *kdf_cache_fill(uint32_t epoch) {
+    kdf_cache_entry_t *victim = &kdf_cache[0];
+    uint8_t key[AES_KEY_SIZE];
+
+    for (uint32_t i = 0; i < KDF_CACHE_SIZE; i++) {
+        if (!kdf_cache[i].valid) {
+            victim = &kdf_cache[i];
+            break;
+        }
+        if (kdf_cache[i].last_used < victim->last_used) {
+            victim = &kdf_cache[i];
+        }
+    }
+
+    kdf_derive_key(epoch, key);
+    aes_gcm_setkey(&victim->ctx, key);
+    memset(key, 0, sizeof(key));
+
+    victim->valid = true;
+    victim->epoch = epoch;
+    victim->last_used = ++kdf_clock;
+    return victim;
+}
+
+const aes_gcm_ctx_t *kdf_get_ctx(uint32_t epoch) {
+    kdf_cache_entry_t *entry = kdf_cache_find(epoch);
+
+    if (entry != NULL) {
+        kdf_stats.hits++;
+        entry->last_used = ++kdf_clock;
+    } else {
+        kdf_stats.misses++;
+        entry = kdf_cache_fill(epoch);
+    }
+    return &entry->ctx;
+}
+
+void kdf_background(uint32_t current_epoch) {
+    if (kdf_cache_find(current_epoch + 1) == NULL) {
+        kdf_stats.prefetches++;
+        kdf_cache_fill(current_epoch + 1);
+    }
+}
+
+const kdf_stats_t *kdf_get_stats(void) {
+    return &kdf_stats;
+}
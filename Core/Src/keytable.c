@@ -0,0 +1,154 @@
+#include "keytable.h"
+#include <string.h>
+
+/*
+ * Open-addressed hash table keyed by (peer, key_id) with linear probing.
+ * The table is sized well above the expected fleet so probe chains stay
+ * short and lookup cost does not grow with the number of nodes.
+ */
+static keytable_entry_t keytable[KEYTABLE_SIZE];
+
+static uint32_t keytable_hash(uint8_t peer, uint8_t key_id) {
+    uint32_t k = ((uint32_t)peer << 7) | key_id;
+    // Knuth multiplicative hash, callers mask the result to the table size
+    return (k * 2654435761UL) >> 16;
+}
+
+void keytable_init(void) {
+    memset(keytable, 0, sizeof(keytable));
+}
+
+static keytable_entry_t *keytable_find(uint8_t peer, uint8_t key_id, bool for_insert) {
+    uint32_t idx = keytable_hash(peer, key_id) & (KEYTABLE_SIZE - 1);
+
+    for (uint32_t probe = 0; probe < KEYTABLE_SIZE; probe++) {
+        keytable_entry_t *entry = &keytable[idx];
+        if (!entry->used) {
+            return for_insert ? entry : NULL;
+        }
+        if (entry->peer == peer && entry->key_id == key_id) {
+            return entry;
+        }
+        idx = (idx + 1) & (KEYTABLE_SIZE - 1);
+    }
+    return NULL;
+}
+
+static void keytable_clear_windows(key_slot_t *slot) {
+    nonce_window_init(&slot->window);
+    nonce_window_init(&slot->frag_window);
+}
+
+bool keytable_add(uint8_t peer, uint8_t key_id, uint32_t epoch, const uint8_t *key) {
+    key_id &= KEY_HINT_ID_MASK;
+
+    keytable_entry_t *entry = keytable_find(peer, key_id, true);
+    if (entry == NULL) return false;
+
+    entry->used = true;
+    entry->peer = peer;
+    entry->key_id = key_id;
+    entry->epoch = epoch;
+    entry->slot[epoch & 1].state = KEY_SLOT_ACTIVE;
+    entry->slot[(epoch + 1) & 1].state = KEY_SLOT_EMPTY;
+    aes_gcm_setkey(&entry->slot[epoch & 1].ctx, key);
+    keytable_clear_windows(&entry->slot[epoch & 1]);
+    return true;
+}
+
+keytable_entry_t *keytable_lookup(uint8_t peer, uint8_t key_hint) {
+    return keytable_find(peer, key_hint & KEY_HINT_ID_MASK, false);
+}
+
+static key_slot_t *keytable_slot(keytable_entry_t *entry, uint32_t epoch) {
+    return &entry->slot[epoch & 1];
+}
+
+bool keytable_stage_next(keytable_entry_t *entry, const uint8_t *key) {
+    key_slot_t *next = keytable_slot(entry, entry->epoch + 1);
+
+    if (next->state == KEY_SLOT_RETIRING) return false;
+
+    aes_gcm_setkey(&next->ctx, key);
+    keytable_clear_windows(next);
+    next->state = KEY_SLOT_NEXT;
+    return true;
+}
+
+bool keytable_stage_next_ctx(keytable_entry_t *entry, const aes_gcm_ctx_t *ctx) {
+    key_slot_t *next = keytable_slot(entry, entry->epoch + 1);
+
+    if (next->state == KEY_SLOT_RETIRING) return false;
+
+    memcpy(&next->ctx, ctx, sizeof(aes_gcm_ctx_t));
+    keytable_clear_windows(next);
+    next->state = KEY_SLOT_NEXT;
+    return true;
+}
+
+bool keytable_rotate(keytable_entry_t *entry) {
+    key_slot_t *current = keytable_slot(entry, entry->epoch);
+    key_slot_t *next = keytable_slot(entry, entry->epoch + 1);
+
+    if (next->state != KEY_SLOT_NEXT) return false;
+
+    // Deadline is set by keytable_tick(), which knows the time
+    current->state = KEY_SLOT_RETIRING;
+    current->retire_at = 0;
+    next->state = KEY_SLOT_ACTIVE;
+    entry->epoch++;
+    return true;
+}
+
+void keytable_resync(keytable_entry_t *entry, uint32_t epoch, const aes_gcm_ctx_t *ctx) {
+    key_slot_t *slot = keytable_slot(entry, epoch);
+
+    memcpy(&slot->ctx, ctx, sizeof(aes_gcm_ctx_t));
+    keytable_clear_windows(slot);
+    slot->state = KEY_SLOT_ACTIVE;
+    keytable_slot(entry, epoch + 1)->state = KEY_SLOT_EMPTY;
+    entry->epoch = epoch;
+}
+
+const aes_gcm_ctx_t *keytable_rx_ctx(const keytable_entry_t *entry, uint8_t key_hint) {
+    const key_slot_t *slot = &entry->slot[(key_hint & KEY_HINT_EPOCH_BIT) ? 1 : 0];
+    return (slot->state == KEY_SLOT_EMPTY) ? NULL : &slot->ctx;
+}
+
+nonce_window_t *keytable_rx_window(keytable_entry_t *entry, uint8_t key_hint, bool fragment) {
+    key_slot_t *slot = &entry->slot[(key_hint & KEY_HINT_EPOCH_BIT) ? 1 : 0];
+    return fragment ? &slot->frag_window : &slot->window;
+}
+
+void keytable_rx_confirm(keytable_entry_t *entry, uint8_t key_hint) {
+    uint8_t idx = (key_hint & KEY_HINT_EPOCH_BIT) ? 1 : 0;
+    if (entry->slot[idx].state == KEY_SLOT_NEXT) {
+        keytable_rotate(entry);
+    }
+}
+
+const aes_gcm_ctx_t *keytable_tx_ctx(const keytable_entry_t *entry) {
+    return &entry->slot[entry->epoch & 1].ctx;
+}
+
+uint8_t keytable_tx_hint(const keytable_entry_t *entry) {
+    return entry->key_id | ((entry->epoch & 1) ? KEY_HINT_EPOCH_BIT : 0);
+}
+
+void keytable_tick(uint32_t now) {
+    for (uint32_t i = 0; i < KEYTABLE_SIZE; i++) {
+        if (!keytable[i].used) continue;
+
+        for (uint32_t j = 0; j < 2; j++) {
+            key_slot_t *slot = &keytable[i].slot[j];
+            if (slot->state != KEY_SLOT_RETIRING) continue;
+
+            if (slot->retire_at == 0) {
+                // First tick after rotation starts the grace period (0 means unset)
+                slot->retire_at = (now + KEYTABLE_GRACE_MS) | 1;
+            } else if ((int32_t)(now - slot->retire_at) >= 0) {
+                slot->state = KEY_SLOT_EMPTY;
+            }
+        }
+    }
+}
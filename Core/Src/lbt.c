@@ -0,0 +1,48 @@
+#include "lbt.h"
+#include <string.h>
+
+static lbt_stats_t lbt_stats;
+static uint32_t rng_state;
+static bool lbt_on;
+
+// xorshift32: cheap and good enough to decorrelate neighbouring nodes
+static uint32_t lbt_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+void lbt_init(uint32_t seed, bool enabled) {
+    // xorshift must not start from zero
+    rng_state = seed ? seed : 0x6D2B79F5;
+    lbt_on = enabled;
+    memset(&lbt_stats, 0, sizeof(lbt_stats));
+}
+
+bool lbt_enabled(void) {
+    return lbt_on;
+}
+
+void lbt_record_cad(bool busy) {
+    lbt_stats.cad_runs++;
+    if (busy) lbt_stats.busy++;
+}
+
+uint32_t lbt_backoff(uint8_t attempt) {
+    uint8_t exponent = attempt < LBT_MAX_EXPONENT ? attempt : LBT_MAX_EXPONENT;
+    uint32_t window = 1UL << exponent;
+    uint32_t delay = (1 + (lbt_random() & (window - 1))) * LBT_SLOT_MS;
+
+    lbt_stats.backoffs++;
+    lbt_stats.backoff_ms += delay;
+    return delay;
+}
+
+void lbt_record_drop(void) {
+    lbt_stats.dropped++;
+}
+
+const lbt_stats_t *lbt_get_stats(void) {
+    return &lbt_stats;
+}
@@ -0,0 +1,70 @@
+#include "lora_frame.h"
+#include <string.h>
+
+void lora_frame_parse_header(const uint8_t *frame, lora_frame_header_t *header) {
+    header->net_id   = frame[FRAME_OFF_NET_ID];
+    header->dst      = frame[FRAME_OFF_DST];
+    header->src      = frame[FRAME_OFF_SRC];
+    header->type     = frame[FRAME_OFF_TYPE];
+    header->key_hint = frame[FRAME_OFF_KEY];
+    header->counter  = ((uint32_t)frame[FRAME_OFF_COUNTER] << 24) |
+                       ((uint32_t)frame[FRAME_OFF_COUNTER + 1] << 16) |
+                       ((uint32_t)frame[FRAME_OFF_COUNTER + 2] << 8) |
+                       (uint32_t)frame[FRAME_OFF_COUNTER + 3];
+}
+
+void lora_frame_write_header(const lora_frame_header_t *header, uint8_t *frame) {
+    frame[FRAME_OFF_NET_ID]      = header->net_id;
+    frame[FRAME_OFF_DST]         = header->dst;
+    frame[FRAME_OFF_SRC]         = header->src;
+    frame[FRAME_OFF_TYPE]        = header->type;
+    frame[FRAME_OFF_KEY]         = header->key_hint;
+    frame[FRAME_OFF_COUNTER]     = (header->counter >> 24) & 0xFF;
+    frame[FRAME_OFF_COUNTER + 1] = (header->counter >> 16) & 0xFF;
+    frame[FRAME_OFF_COUNTER + 2] = (header->counter >> 8) & 0xFF;
+    frame[FRAME_OFF_COUNTER + 3] = header->counter & 0xFF;
+}
+
+void lora_frame_build_nonce(const lora_frame_header_t *header, uint8_t *nonce) {
+    memset(nonce, 0, GCM_NONCE_SIZE);
+    nonce[0]  = header->net_id;
+    nonce[1]  = header->src;
+    nonce[8]  = (header->counter >> 24) & 0xFF;
+    nonce[9]  = (header->counter >> 16) & 0xFF;
+    nonce[10] = (header->counter >> 8) & 0xFF;
+    nonce[11] = header->counter & 0xFF;
+}
+
+uint8_t lora_frame_seal(const aes_gcm_ctx_t *ctx, const lora_frame_header_t *header,
+                        const uint8_t *payload, uint8_t payload_len,
+                        uint8_t *frame) {
+    uint8_t nonce[GCM_NONCE_SIZE];
+
+    if (payload_len > FRAME_MAX_PAYLOAD) return 0;
+
+    lora_frame_write_header(header, frame);
+    lora_frame_build_nonce(header, nonce);
+
+    // Header is the AAD, ciphertext follows it, tag closes the frame
+    aes_gcm_encrypt_ctx(ctx, nonce, payload, payload_len,
+                        frame, FRAME_HEADER_SIZE,
+                        frame + FRAME_HEADER_SIZE,
+                        frame + FRAME_HEADER_SIZE + payload_len);
+
+    return payload_len + FRAME_OVERHEAD;
+}
+
+bool lora_frame_open(const aes_gcm_ctx_t *ctx, const lora_frame_header_t *header,
+                     const uint8_t *frame, uint8_t frame_len,
+                     uint8_t *payload) {
+    uint8_t nonce[GCM_NONCE_SIZE];
+    uint8_t payload_len = frame_len - FRAME_OVERHEAD;
+
+    lora_frame_build_nonce(header, nonce);
+
+    return aes_gcm_decrypt_ctx(ctx, nonce,
+                               frame + FRAME_HEADER_SIZE, payload_len,
+                               frame, FRAME_HEADER_SIZE,
+                               frame + FRAME_HEADER_SIZE + payload_len,
+                               payload);
+}
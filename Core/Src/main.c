@@ -22,6 +22,24 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "sx1272.h"
+#include "nonce.h"
+#include "lora_frame.h"
+#include "rx_filter.h"
+#include "keytable.h"
+#include "kdf.h"
+#include "radio_event.h"
+#include "radio_irq.h"
+#include "tx_queue.h"
+#include "lbt.h"
+#include "adr.h"
+#include "duty.h"
+#include "channel_plan.h"
+#include "tdma.h"
+#include "frag.h"
+#include "arq.h"
+#include "persist.h"
+#include "cycle_counter.h"
+#include <string.h>
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -31,7 +49,39 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
-
+#define LORA_NET_ID     0x42
+#define LORA_LOCAL_ADDR 0x01
+#define LORA_PEER_ADDR  0x02
+#define LORA_KEY_ID     0x01
+#define LORA_KDF_LABEL  0x01
+#define LORA_EPOCH_MS   (24UL * 60 * 60 * 1000)
+// Epoch announcements are sealed under a key that never rotates, derived
+// from an epoch number the data key never reaches
+#define LORA_SYNC_KEY_ID  0x7F
+#define LORA_SYNC_EPOCH   UINT32_MAX
+#define LORA_SYNC_MIN_MS  10000
+// Beacons go to every node under a network key they all derive, filed
+// under the gateway's address
+#define LORA_NET_KEY_ID   0x7E
+#define LORA_NET_EPOCH    (UINT32_MAX - 1)
+#ifdef LORA_TDMA_GATEWAY
+#define LORA_GATEWAY_ADDR LORA_LOCAL_ADDR
+#else
+#define LORA_GATEWAY_ADDR LORA_PEER_ADDR
+#endif
+// Define LORA_HOPPING to hop over the channel plan. All nodes must share
+// the time base that selects the hop slot.
+#define LORA_HOP_SEED   0x4C6F5261
+#define LORA_DWELL_MS   2000
+// Define LORA_TDMA to send only in the slot assigned by the gateway's
+// beacons, and LORA_TDMA_GATEWAY on the node that sends them. With TDMA
+// hopping follows the superframe number instead of the local tick.
+#define LORA_TDMA_PERIOD_MS 1000
+#define LORA_TDMA_SLOT_MS   250
+// Longer messages go out as fragments sized for one split-FIFO region
+#define LORA_FRAG_FRAME_MAX SX1272_FIFO_SPLIT_SIZE
+// Reliable frames in flight to the peer, up to ARQ_WINDOW_MAX
+#define LORA_ARQ_WINDOW     8
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -43,32 +93,477 @@
 CRC_HandleTypeDef hcrc;
 
 SPI_HandleTypeDef hspi1;
+DMA_HandleTypeDef hdma_spi1_rx;
+DMA_HandleTypeDef hdma_spi1_tx;
 
 /* USER CODE BEGIN PV */
-extern uint8_t SX1272_RxBuffer[256];
+static sx1272_t lora = {
+    .spi       = &hspi1,
+    .nssPort   = LORA_NSS_GPIO_Port,
+    .nssPin    = LORA_NSS_Pin,
+    .resetPort = LORA_RESET_GPIO_Port,
+    .resetPin  = LORA_RESET_Pin,
+    .dio0Pin   = LORA_DIO0_Pin,
+};
+static const uint8_t lora_master_key[AES_KEY_SIZE] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+static persist_state_t linkState;
+static uint32_t bootEpoch;
+static bool epochSent;
+static uint32_t epochSentAt;
+
+#ifdef LORA_BENCHMARK
+// Average cycles per kdf_get_ctx() call, read out with the debugger
+typedef struct {
+    uint32_t miss_cycles;
+    uint32_t hit_cycles;
+} KdfBench_t;
+volatile KdfBench_t kdfBench;
+SX1272_RegBench_t regBench;
+#endif
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
+static void MX_DMA_Init(void);
 static void MX_CRC_Init(void);
 static void MX_SPI1_Init(void);
 /* USER CODE BEGIN PFP */
-uint8_t txBuffer[256];
-uint8_t rxBuffer[256];
 uint8_t status;
-uint8_t irqFlags;
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
+// Keeps the frame counter ahead of everything sent before a reset
+static void StoreCounterLimit(uint32_t limit)
+{
+    linkState.counter = limit;
+    persist_save(&linkState);
+}
+
+// Seals into a frame taken from tx_queue_alloc() and queues it; the frame
+// goes back to the queue if the payload does not fit
+static bool SealFrame(tx_frame_t *frame, uint8_t dst, const keytable_entry_t *key, uint8_t type,
+                      const uint8_t *payload, uint8_t len, tx_priority_t priority)
+{
+    lora_frame_header_t header = {
+        .net_id   = LORA_NET_ID,
+        .dst      = dst,
+        .src      = LORA_LOCAL_ADDR,
+        .type     = type,
+        .key_hint = keytable_tx_hint(key),
+        .counter  = nonce_generate(),
+    };
+    uint8_t frameLen = lora_frame_seal(keytable_tx_ctx(key), &header, payload, len, frame->data);
+    if (frameLen == 0) {
+        tx_queue_release(frame);
+        return false;
+    }
+    tx_queue_submit(frame, frameLen, priority);
+    radio_irq_kick();
+    return true;
+}
+
+// Returns false if the frame was not queued: no key, queue full or too long
+static bool SendFrameTo(uint8_t dst, const keytable_entry_t *key, uint8_t type,
+                        const uint8_t *payload, uint8_t len, tx_priority_t priority)
+{
+    if (key == NULL) return false;
+
+    // Seal straight into a queue frame; the radio sends it from there
+    tx_frame_t *frame = tx_queue_alloc();
+    if (frame == NULL) return false;
+
+    return SealFrame(frame, dst, key, type, payload, len, priority);
+}
+
+static bool SendFrame(uint8_t type, const uint8_t *payload, uint8_t len, tx_priority_t priority)
+{
+    return SendFrameTo(LORA_PEER_ADDR, keytable_lookup(LORA_PEER_ADDR, LORA_KEY_ID), type, payload, len, priority);
+}
+
+// Sends short messages through the ARQ, longer ones as fragments. Returns
+// false if the message was not taken: ARQ window full, a fragmented
+// message still in flight, no key or too long.
+static bool SendMessage(const uint8_t *message, uint16_t len)
+{
+    if (len <= ARQ_PAYLOAD_MAX) {
+        return arq_send(message, len);
+    }
+
+    // Check before spending a counter; a new message would abandon the old one
+    keytable_entry_t *key = keytable_lookup(LORA_PEER_ADDR, LORA_KEY_ID);
+    if (key == NULL || frag_tx_busy()) return false;
+
+    lora_frame_header_t header = {
+        .net_id   = LORA_NET_ID,
+        .dst      = LORA_PEER_ADDR,
+        .src      = LORA_LOCAL_ADDR,
+        .key_hint = keytable_tx_hint(key),
+        .counter  = nonce_generate(),
+    };
+    return frag_tx_start(keytable_tx_ctx(key), &header, message, len, LORA_FRAG_FRAME_MAX) != 0;
+}
+
+static void UpdateFragments(void)
+{
+    uint8_t status[FRAG_STATUS_SIZE];
+    uint8_t peer;
+
+    frag_tick(HAL_GetTick());
+
+    // Point to point: every status goes to LORA_PEER_ADDR
+    while (frag_rx_status(&peer, status)) {
+        SendFrame(FRAME_TYPE_FRAG_STATUS, status, sizeof(status), TX_PRIO_HIGH);
+    }
+
+    // One fragment at a time, so control frames never wait behind a whole message
+    if (frag_tx_state() == FRAG_TX_SENDING && !tx_queue_pending()) {
+        tx_frame_t *frame = tx_queue_alloc();
+        if (frame == NULL) return;
+
+        uint8_t frameLen = frag_tx_next(frame->data);
+        if (frameLen == 0) {
+            tx_queue_release(frame);
+            return;
+        }
+        tx_queue_submit(frame, frameLen, TX_PRIO_LOW);
+        radio_irq_kick();
+    }
+}
+
+static void UpdateArq(void)
+{
+    uint8_t payload[ARQ_HEADER_SIZE + ARQ_PAYLOAD_MAX];
+    uint8_t type;
+    uint32_t now = HAL_GetTick();
+
+    arq_tick(now);
+
+    // Built only when the queue is empty, so the piggybacked ack is fresh when sent
+    if (tx_queue_pending()) return;
+
+    // arq_next() marks the frame sent and the ack delivered: take the key
+    // and a queue frame first, so it only runs when the frame goes out
+    keytable_entry_t *key = keytable_lookup(LORA_PEER_ADDR, LORA_KEY_ID);
+    if (key == NULL) return;
+    tx_frame_t *frame = tx_queue_alloc();
+    if (frame == NULL) return;
+
+    uint8_t len = arq_next(&type, payload, now);
+    if (len == 0) {
+        tx_queue_release(frame);
+        return;
+    }
+    SealFrame(frame, LORA_PEER_ADDR, key, type, payload, len,
+              (type == FRAME_TYPE_ARQ_ACK) ? TX_PRIO_HIGH : TX_PRIO_NORMAL);
+}
+
+static void ProcessArq(const lora_frame_header_t *header, const uint8_t *payload, uint8_t len)
+{
+    const uint8_t *data;
+    uint8_t dataLen;
+
+    arq_on_frame(header->type, payload, len, HAL_GetTick());
+    while ((data = arq_peek(&dataLen)) != NULL) {
+        // data holds dataLen bytes, in sequence
+        arq_release();
+    }
+}
+
+static void ProcessMessage(const lora_frame_header_t *header)
+{
+    uint16_t len;
+    const uint8_t *message = frag_rx_message(header, &len);
+
+    if (message != NULL) {
+        // message holds len bytes of authenticated plaintext
+        frag_rx_release(header);
+    }
+}
+
+static void ProcessControl(const lora_frame_header_t *header, const uint8_t *payload, uint8_t len)
+{
+    SX1272_ModemParams_t params;
+    uint8_t reply;
+
+    if (adr_handle_control(header->src, payload, len, HAL_GetTick(), &params, &reply)) {
+        if (reply != 0) {
+            // Acknowledge with the old parameters, the switch waits for the queue
+            uint8_t control[ADR_PAYLOAD_SIZE];
+            adr_encode(reply, &params, control);
+            SendFrame(FRAME_TYPE_CONTROL, control, sizeof(control), TX_PRIO_HIGH);
+        }
+        radio_irq_set_modem(&params);
+    }
+}
+
+static void UpdateLink(void)
+{
+    SX1272_ModemParams_t params;
+    uint32_t now = HAL_GetTick();
+
+    if (adr_evaluate(LORA_PEER_ADDR, now, &params)) {
+        uint8_t control[ADR_PAYLOAD_SIZE];
+        adr_encode(ADR_CMD_REQUEST, &params, control);
+        SendFrame(FRAME_TYPE_CONTROL, control, sizeof(control), TX_PRIO_HIGH);
+    }
+    if (adr_tick(now, &params)) {
+        // Peer went silent after a switch: fall back
+        radio_irq_set_modem(&params);
+    }
+}
+
+#ifdef LORA_HOPPING
+static void UpdateChannel(void)
+{
+    static uint32_t lastHop = UINT32_MAX;
+#ifdef LORA_TDMA
+    uint32_t hop = tdma_superframe();
+#else
+    uint32_t hop = HAL_GetTick() / LORA_DWELL_MS;
+#endif
+
+    if (hop != lastHop) {
+        radio_irq_set_channel(channel_plan_hop(hop));
+        lastHop = hop;
+    }
+}
+#endif
+
+#ifdef LORA_TDMA
+#ifdef LORA_TDMA_GATEWAY
+static void StartSuperframes(void)
+{
+    tdma_beacon_t layout = {
+        .seq        = 0,
+        .period_ms  = LORA_TDMA_PERIOD_MS,
+        .slot_ms    = LORA_TDMA_SLOT_MS,
+        .slot_count = 2,
+        .owner      = { LORA_LOCAL_ADDR, LORA_PEER_ADDR },
+    };
+
+    tdma_gateway_start(&layout);
+}
+
+static void SendBeacon(void)
+{
+    tdma_beacon_t beacon;
+    uint8_t payload[TDMA_BEACON_MAX];
+
+    // Queued right after the gateway slot closes, sent when the next one opens
+    if (tdma_beacon_due(&beacon)) {
+        SendFrameTo(FRAME_ADDR_BROADCAST, keytable_lookup(LORA_GATEWAY_ADDR, LORA_NET_KEY_ID),
+                    FRAME_TYPE_BEACON, payload, tdma_beacon_encode(&beacon, payload), TX_PRIO_HIGH);
+    }
+}
+#else
+static void ProcessBeacon(const rx_packet_t *packet, const uint8_t *payload, uint8_t len)
+{
+    tdma_beacon_t beacon;
+
+    if (!tdma_beacon_decode(payload, len, &beacon)) return;
+
+    // RxDone marks the end of the beacon: back out the time since then and its airtime
+    uint32_t sinceRxDone = cycle_counter_to_us(cycle_counter_read() - packet->cycles);
+    uint32_t start = tdma_now_us() - sinceRxDone - SX1272_TimeOnAir(&lora, packet->length, false);
+
+    tdma_on_beacon(&beacon, start);
+}
+#endif
+#endif
+
+// Tells the peer our epoch under the sync key
+static void SendEpoch(void)
+{
+    keytable_entry_t *key = keytable_lookup(LORA_PEER_ADDR, LORA_KEY_ID);
+    uint32_t now = HAL_GetTick();
+    uint8_t payload[4];
+
+    // A peer on another epoch keeps sending frames we reject: answer once in a while
+    if (key == NULL || (epochSent && now - epochSentAt < LORA_SYNC_MIN_MS)) return;
+
+    payload[0] = (key->epoch >> 24) & 0xFF;
+    payload[1] = (key->epoch >> 16) & 0xFF;
+    payload[2] = (key->epoch >> 8) & 0xFF;
+    payload[3] = key->epoch & 0xFF;
+    SendFrameTo(LORA_PEER_ADDR, keytable_lookup(LORA_PEER_ADDR, LORA_SYNC_KEY_ID), FRAME_TYPE_EPOCH,
+                payload, sizeof(payload), TX_PRIO_HIGH);
+    epochSent = true;
+    epochSentAt = now;
+}
+
+// Epochs only move forward: the node behind jumps, the one ahead answers
+static void ProcessEpoch(const uint8_t *payload, uint8_t len)
+{
+    keytable_entry_t *key = keytable_lookup(LORA_PEER_ADDR, LORA_KEY_ID);
+    if (key == NULL || len < 4) return;
+
+    uint32_t epoch = ((uint32_t)payload[0] << 24) | ((uint32_t)payload[1] << 16) |
+                     ((uint32_t)payload[2] << 8) | payload[3];
+
+    if ((int32_t)(epoch - key->epoch) > 0) {
+        keytable_resync(key, epoch, kdf_get_ctx(epoch));
+    } else if (epoch != key->epoch) {
+        SendEpoch();
+    }
+}
+
+static void ProcessRxFrame(void)
+{
+    lora_frame_header_t header;
+    uint8_t payloadLen;
+    rx_packet_t *packet;
+    rx_filter_result_t result;
+
+    while ((packet = rx_ring_peek(&lora.rxRing)) != NULL) {
+        // Decrypt in place, the plaintext replaces the ciphertext in the slot
+        uint8_t *payload = packet->data + FRAME_HEADER_SIZE;
+
+        result = rx_filter_process(packet->data, packet->length, &header, payload, &payloadLen);
+        if ((result == RX_FILTER_REJECT_KEY || result == RX_FILTER_REJECT_AUTH) &&
+            header.src == LORA_PEER_ADDR && (header.key_hint & KEY_HINT_ID_MASK) == LORA_KEY_ID) {
+            // The peer seals under an epoch we do not hold
+            SendEpoch();
+        }
+        if (result == RX_FILTER_ACCEPT) {
+            // payload now holds payloadLen bytes of authenticated plaintext
+            adr_record(header.src, packet->snr, packet->rssi);
+            if (header.type == FRAME_TYPE_CONTROL) {
+                ProcessControl(&header, payload, payloadLen);
+            }
+            if (header.type == FRAME_TYPE_FRAGMENT) {
+                ProcessMessage(&header);
+            }
+            if (header.type == FRAME_TYPE_FRAG_STATUS) {
+                frag_tx_status(payload, payloadLen);
+            }
+            if (header.type == FRAME_TYPE_ARQ || header.type == FRAME_TYPE_ARQ_ACK) {
+                ProcessArq(&header, payload, payloadLen);
+            }
+            if (header.type == FRAME_TYPE_EPOCH) {
+                ProcessEpoch(payload, payloadLen);
+            }
+#if defined(LORA_TDMA) && !defined(LORA_TDMA_GATEWAY)
+            if (header.type == FRAME_TYPE_BEACON && header.src == LORA_GATEWAY_ADDR &&
+                (header.key_hint & KEY_HINT_ID_MASK) == LORA_NET_KEY_ID) {
+                ProcessBeacon(packet, payload, payloadLen);
+            }
+#endif
+        }
+        rx_ring_release(&lora.rxRing);
+    }
+}
+
+// Epoch on the time base the nodes share: the gateway's superframe count
+// under TDMA, otherwise uptime on top of the epoch stored at the last
+// reset. Then the node that crosses a boundary first takes its peer along
+// through keytable_rx_confirm(), and SendEpoch() catches up a peer that
+// was off for longer.
+static uint32_t CurrentEpoch(void)
+{
+#ifdef LORA_TDMA
+    return tdma_superframe() / (LORA_EPOCH_MS / LORA_TDMA_PERIOD_MS);
+#else
+    return bootEpoch + HAL_GetTick() / LORA_EPOCH_MS;
+#endif
+}
+
+static void UpdateKeyEpoch(void)
+{
+    keytable_entry_t *key = keytable_lookup(LORA_PEER_ADDR, LORA_KEY_ID);
+    if (key == NULL) return;
+
+    // key->epoch also advances when we follow the peer, so the staged key is
+    // always the epoch after the one in use. Expand it off the packet path.
+    kdf_background(key->epoch);
+    if (key->slot[(key->epoch + 1) & 1].state == KEY_SLOT_EMPTY) {
+        keytable_stage_next_ctx(key, kdf_get_ctx(key->epoch + 1));
+    }
+
+    // Never rotate onto an epoch already reached by following the peer; a
+    // clock further ahead (first beacon after a reset) is a jump
+    int32_t ahead = (int32_t)(CurrentEpoch() - key->epoch);
+    if (ahead > 1) {
+        keytable_resync(key, CurrentEpoch(), kdf_get_ctx(CurrentEpoch()));
+    } else if (ahead > 0) {
+        keytable_rotate(key);
+    }
+    keytable_tick(HAL_GetTick());
+
+    // A reset must not fall back to an older epoch
+    if (key->epoch != linkState.epoch) {
+        linkState.epoch = key->epoch;
+        persist_save(&linkState);
+    }
+}
+
+#ifdef LORA_BENCHMARK
+static void BenchmarkKdf(void)
+{
+    const uint32_t rounds = 16;
+    uint32_t start;
+
+    cycle_counter_init();
+
+    // Distinct epochs never repeat within the cache size: every call misses
+    start = cycle_counter_read();
+    for (uint32_t i = 0; i < rounds; i++) {
+        kdf_get_ctx(1000 + i);
+    }
+    kdfBench.miss_cycles = (cycle_counter_read() - start) / rounds;
+
+    start = cycle_counter_read();
+    for (uint32_t i = 0; i < rounds; i++) {
+        kdf_get_ctx(1000 + rounds - 1);
+    }
+    kdfBench.hit_cycles = (cycle_counter_read() - start) / rounds;
+}
+#endif
+
+static void ProcessRadioEvents(void)
+{
+    static uint32_t dropped = 0;
+    radio_event_t evt;
+    bool rx = false;
+    bool tx = false;
+
+    // The bottom half already did the SPI work; coalesce what it reported
+    while (radio_event_get(&evt))
+    {
+        if (evt.type == RADIO_EVT_RX_DONE) rx = true;
+        if (evt.type == RADIO_EVT_TX_DONE) tx = true;
+    }
+
+    // Events lost to a full queue could be either kind
+    if (radio_event_dropped() != dropped)
+    {
+        dropped = radio_event_dropped();
+        rx = true;
+        tx = true;
+    }
+
+    if (rx)
+    {
+        ProcessRxFrame();
+    }
+    if (tx)
+    {
+        // A slot in the TX queue came free: refill it before the radio idles
+        UpdateFragments();
+        UpdateArq();
+    }
+}
+
 void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
 {
-    if (GPIO_Pin == SX1272_DIO0_PIN)
+    if (GPIO_Pin == lora.dio0Pin)
     {
-        irqFlags = SX1272_ReadReg(REG_IRQ_FLAGS);
-        //printf("EXTI! IRQ=0x%02X\r\n", irqFlags);
-        SX1272_HandleDIO0();
+        // Only latch the edge; the SPI work runs in the PendSV bottom half
+        radio_irq_dio0(HAL_GetTick());
     }
 }
 /* USER CODE END 0 */
@@ -102,18 +597,76 @@ int main(void)
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_CRC_Init();
   MX_SPI1_Init();
   /* USER CODE BEGIN 2 */
-  SX1272_Init();
-  status = SX1272_ReadReg(0x42);
-  SX1272_Receive();
+  radio_event_init();
+  tx_queue_init();
+  radio_irq_init(&lora);
+  // Thread code only touches the radio with the bottom half locked out; a
+  // DIO0 edge meanwhile stays latched until radio_irq_unlock()
+  radio_irq_lock();
+  SX1272_Init(&lora);
+  // Separate TX/RX FIFO regions: frames load without leaving RX
+  SX1272_SetFifoSplit(&lora, true);
+  status = SX1272_ReadReg(&lora, REG_VERSION);
+#ifdef LORA_BENCHMARK
+  SX1272_BenchmarkRegAccess(&lora, 1000, &regBench);
+#endif
+  radio_irq_unlock();
+  // Resume epoch and frame counter where the last reset left them, so no
+  // nonce repeats under a key
+  persist_load(&linkState);
+  bootEpoch = linkState.epoch;
+  nonce_init();
+  nonce_resume(linkState.counter, StoreCounterLimit);
+  keytable_init();
+  kdf_init(lora_master_key, LORA_KDF_LABEL);
+#ifdef LORA_BENCHMARK
+  BenchmarkKdf();
+  kdf_init(lora_master_key, LORA_KDF_LABEL);
+#endif
+  {
+      uint8_t epochKey[AES_KEY_SIZE];
+      kdf_derive_key(bootEpoch, epochKey);
+      keytable_add(LORA_PEER_ADDR, LORA_KEY_ID, bootEpoch, epochKey);
+      kdf_derive_key(LORA_SYNC_EPOCH, epochKey);
+      keytable_add(LORA_PEER_ADDR, LORA_SYNC_KEY_ID, 0, epochKey);
+#ifdef LORA_TDMA
+      kdf_derive_key(LORA_NET_EPOCH, epochKey);
+      keytable_add(LORA_GATEWAY_ADDR, LORA_NET_KEY_ID, 0, epochKey);
+#endif
+      memset(epochKey, 0, sizeof(epochKey));
+  }
+  rx_filter_init(LORA_NET_ID, LORA_LOCAL_ADDR);
+  frag_init();
+  arq_init(LORA_ARQ_WINDOW, HAL_GetTick());
+  adr_init(SX1272_GetModemParams(&lora));
+  // Backoff seed from RSSI noise, so neighbouring nodes do not back off in
+  // step. The radio is in RX now: keep a DIO0 bottom half off the bus.
+  radio_irq_lock();
+  SX1272_Receive(&lora);
+  uint32_t entropy = SX1272_ReadEntropy(&lora);
+  radio_irq_unlock();
+  lbt_init(entropy, true);
+  duty_init(HAL_GetTick());
+#ifdef LORA_HOPPING
+  channel_plan_init(LORA_HOP_SEED ^ LORA_NET_ID);
+#endif
+#ifdef LORA_TDMA
+  tdma_timer_init();
+  tdma_init(LORA_LOCAL_ADDR);
+#ifdef LORA_TDMA_GATEWAY
+  StartSuperframes();
+#endif
+#endif
   int8_t msg[] = "Hello World";
 
  // Start receiving
  HAL_Delay(2000);
  uint8_t counter = 0;
- SX1272_Transmit(msg, strlen((char*)msg));
+ SendMessage((uint8_t*)msg, strlen((char*)msg));
   /* USER CODE END 2 */
 
   /* Infinite loop */
@@ -121,16 +674,33 @@ int main(void)
   while (1)
   {
 	  static uint32_t lastSend = 0;
-	  if(HAL_GetTick() - lastSend >= 5000) {
-		  SX1272_Transmit(msg, strlen((char*)msg));
+	  // A message that was not taken is tried again on the next pass
+	  if(HAL_GetTick() - lastSend >= 5000 &&
+	     SendMessage((uint8_t*)msg, strlen((char*)msg))) {
 		  lastSend = HAL_GetTick();
 	  }
 
-	  if (SX1272_ReadReg(REG_IRQ_FLAGS) & IRQ_RX_DONE_MASK)
+	  radio_irq_poll(HAL_GetTick());
+	  ProcessRadioEvents();
+	  UpdateKeyEpoch();
+	  UpdateLink();
+	  UpdateFragments();
+	  UpdateArq();
+#ifdef LORA_TDMA_GATEWAY
+	  SendBeacon();
+#endif
+#ifdef LORA_HOPPING
+	  UpdateChannel();
+#endif
+
+	  // Sleep until the next interrupt (bottom half, DMA or SysTick). Interrupts are
+	  // masked around the check so an event posted in between still wakes WFI.
+	  __disable_irq();
+	  if (!radio_event_pending())
 	  {
-	      //printf("POLLED RX DONE\r\n");
-	      SX1272_HandleDIO0();
+		  __WFI();
 	  }
+	  __enable_irq();
 
     /* USER CODE END WHILE */
 
@@ -256,6 +826,26 @@ static void MX_SPI1_Init(void)
 
 }
 
+/**
+  * Enable DMA controller clock
+  */
+static void MX_DMA_Init(void)
+{
+
+  /* DMA controller clock enable */
+  __HAL_RCC_DMAMUX1_CLK_ENABLE();
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  /* DMA interrupt init */
+  /* DMA1_Channel1_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel1_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+  /* DMA1_Channel2_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel2_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel2_IRQn);
+
+}
+
 /**
   * @brief GPIO Initialization Function
   * @param None
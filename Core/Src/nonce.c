@@ -1,10 +1,17 @@
 #include "nonce.h"
+#include <stddef.h>
 
 /**
  * @brief Static counter for generating unique nonces.
  */
 static uint32_t nonce_counter = 0;
 
+/**
+ * @brief End of the block stored through nonce_reserve.
+ */
+static uint32_t nonce_limit = 0;
+static void (*nonce_reserve)(uint32_t limit) = NULL;
+
 /**
  * @brief Last received nonce for validation.
  */
@@ -17,9 +24,20 @@ static uint32_t last_received_nonce = 0;
  */
 void nonce_init(void) {
     nonce_counter = 0;
+    nonce_limit = 0;
+    nonce_reserve = NULL;
     last_received_nonce = 0;
 }
 
+/**
+ * @brief Continues counting after a reset instead of restarting at zero.
+ */
+void nonce_resume(uint32_t start, void (*reserve)(uint32_t limit)) {
+    nonce_counter = start;
+    nonce_limit = start;
+    nonce_reserve = reserve;
+}
+
 /**
  * @brief Generates and returns the next nonce value for transmission.
  * 
@@ -28,6 +46,10 @@ void nonce_init(void) {
  * @return uint32_t The next nonce value.
  */
 uint32_t nonce_generate(void) {
+    if (nonce_reserve != NULL && nonce_counter >= nonce_limit) {
+        nonce_limit = nonce_counter + NONCE_RESERVE_BLOCK;
+        nonce_reserve(nonce_limit);
+    }
     return nonce_counter++;
 }
 
@@ -48,6 +70,47 @@ bool nonce_validate(uint32_t received_nonce) {
     return false;
 }
 
+/**
+ * @brief Clears a replay window so that any counter is accepted next.
+ */
+void nonce_window_init(nonce_window_t *window) {
+    window->last = 0;
+    window->bitmap = 0;
+}
+
+/**
+ * @brief Checks a received counter against a replay window without updating it.
+ *
+ * Counters newer than the last one always pass. Older ones pass only if they
+ * are still inside the window and their bit is not set yet.
+ */
+bool nonce_window_check(const nonce_window_t *window, uint32_t counter) {
+    if (window->bitmap == 0 || counter > window->last) {
+        return true;
+    }
+    uint32_t age = window->last - counter;
+    if (age >= NONCE_WINDOW_SIZE) {
+        return false;
+    }
+    return (window->bitmap & (1UL << age)) == 0;
+}
+
+/**
+ * @brief Marks a counter as received, sliding the window forward if needed.
+ */
+void nonce_window_update(nonce_window_t *window, uint32_t counter) {
+    if (window->bitmap == 0) {
+        window->last = counter;
+        window->bitmap = 1;
+    } else if (counter > window->last) {
+        uint32_t shift = counter - window->last;
+        window->bitmap = (shift >= NONCE_WINDOW_SIZE) ? 1 : ((window->bitmap << shift) | 1);
+        window->last = counter;
+    } else {
+        window->bitmap |= 1UL << (window->last - counter);
+    }
+}
+
 /*
  * Example usage in main loop (e.g., in main.c or sx1272.c):
  * 
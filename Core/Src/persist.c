@@ -0,0 +1,72 @@
+#include "persist.h"
+#include "stm32g4xx_hal.h"
+
+#define PERSIST_RECORDS    (FLASH_PAGE_SIZE / sizeof(uint64_t))
+#define PERSIST_ERASED     UINT64_MAX
+
+static uint8_t page;            // Page that takes the next record
+static uint32_t next;           // Its first erased record
+
+static uint64_t persist_read(uint8_t p, uint32_t index) {
+    uint32_t addr = FLASH_BASE + (PERSIST_PAGE + p) * FLASH_PAGE_SIZE + index * sizeof(uint64_t);
+    return *(const volatile uint64_t *)addr;
+}
+
+void persist_load(persist_state_t *state) {
+    uint64_t newest = 0;
+
+    state->epoch = 0;
+    state->counter = 0;
+    page = 0;
+    next = 0;
+
+    for (uint8_t p = 0; p < PERSIST_PAGES; p++) {
+        uint32_t used = 0;
+
+        while (used < PERSIST_RECORDS && persist_read(p, used) != PERSIST_ERASED) used++;
+        if (used == 0) continue;
+
+        // Records only grow, so the last one of a page is its newest
+        uint64_t record = persist_read(p, used - 1);
+        if (record >= newest) {
+            newest = record;
+            page = p;
+            next = used;
+        }
+    }
+
+    state->epoch = (uint32_t)(newest >> 32);
+    state->counter = (uint32_t)newest;
+}
+
+bool persist_save(const persist_state_t *state) {
+    uint64_t record = ((uint64_t)state->epoch << 32) | state->counter;
+    HAL_StatusTypeDef status = HAL_OK;
+
+    HAL_FLASH_Unlock();
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+
+    if (next >= PERSIST_RECORDS) {
+        FLASH_EraseInitTypeDef erase = {
+            .TypeErase = FLASH_TYPEERASE_PAGES,
+            .Banks     = FLASH_BANK_1,
+            .Page      = PERSIST_PAGE + (page ^ 1),
+            .NbPages   = 1,
+        };
+        uint32_t pageError;
+
+        status = HAL_FLASHEx_Erase(&erase, &pageError);
+        if (status == HAL_OK) {
+            page ^= 1;
+            next = 0;
+        }
+    }
+    if (status == HAL_OK) {
+        uint32_t addr = FLASH_BASE + (PERSIST_PAGE + page) * FLASH_PAGE_SIZE + next * sizeof(uint64_t);
+        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, addr, record);
+        if (status == HAL_OK) next++;
+    }
+
+    HAL_FLASH_Lock();
+    return status == HAL_OK;
+}
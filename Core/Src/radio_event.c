@@ -0,0 +1,49 @@
+#include "radio_event.h"
+
+/*
+ * Single-producer/single-consumer ring. The producer only writes head and
+ * the consumer only writes tail, so no locking is needed on a single core.
+ * One slot is left free to tell a full queue from an empty one.
+ */
+static radio_event_t queue[RADIO_EVENT_QUEUE_SIZE];
+static volatile uint32_t head;
+static volatile uint32_t tail;
+static volatile uint32_t dropped;
+
+void radio_event_init(void) {
+    head = 0;
+    tail = 0;
+    dropped = 0;
+}
+
+bool radio_event_post(radio_event_type_t type, uint32_t tick) {
+    uint32_t next = (head + 1) & (RADIO_EVENT_QUEUE_SIZE - 1);
+
+    if (next == tail) {
+        dropped++;
+        return false;
+    }
+    queue[head].type = type;
+    queue[head].tick = tick;
+    // Publish the slot only after it is filled
+    __asm volatile ("" ::: "memory");
+    head = next;
+    return true;
+}
+
+bool radio_event_get(radio_event_t *event) {
+    if (tail == head) return false;
+
+    *event = queue[tail];
+    __asm volatile ("" ::: "memory");
+    tail = (tail + 1) & (RADIO_EVENT_QUEUE_SIZE - 1);
+    return true;
+}
+
+bool radio_event_pending(void) {
+    return tail != head;
+}
+
+uint32_t radio_event_dropped(void) {
+    return dropped;
+}
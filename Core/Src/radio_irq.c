@@ -0,0 +1,311 @@
+#include "radio_irq.h"
+#include "radio_event.h"
+#include "tx_queue.h"
+#include "lbt.h"
+#include "duty.h"
+#include "channel_plan.h"
+#include "tdma.h"
+#include "sx1272.h"
+#include "cycle_counter.h"
+
+static sx1272_t *radio;
+static volatile bool dio0Latched = false;
+static volatile uint32_t dio0Tick;
+static volatile uint32_t dio0Cycles;
+static volatile bool rxCommitted = false;
+static tx_frame_t *txFrame = NULL;
+static uint8_t txAttempt;
+static volatile bool txBackoff = false;
+static volatile uint32_t txRetryAt;
+static volatile bool txDeferred = false;
+static volatile uint32_t txDeferUntil;
+static SX1272_ModemParams_t modemNext;
+static volatile bool modemPending = false;
+static volatile uint8_t channelNext;
+static volatile bool channelPending = false;
+
+// Header mode per traffic class; class 0 stays explicit unless changed
+typedef struct {
+    bool    implicit;
+    uint8_t length;
+} radio_class_t;
+static radio_class_t classes[RADIO_CLASS_COUNT];
+static volatile uint8_t rxClass = 0;
+static volatile bool rxClassPending = false;
+
+static void radio_irq_pend(void)
+{
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+static const radio_class_t *radio_irq_class(uint8_t tclass)
+{
+    return &classes[tclass < RADIO_CLASS_COUNT ? tclass : 0];
+}
+
+static void radio_irq_use_class(uint8_t tclass)
+{
+    const radio_class_t *c = radio_irq_class(tclass);
+    SX1272_SetHeaderMode(radio, c->implicit, c->length);
+}
+
+static uint32_t radio_irq_airtime(const tx_frame_t *frame)
+{
+    return SX1272_TimeOnAir(radio, frame->length, radio_irq_class(frame->traffic_class)->implicit);
+}
+
+// Duty-cycle scheduler: frames whose airtime does not fit the sub-band
+// budget or the rest of the TDMA slot stay queued, a shorter or later one
+// may go first
+static bool radio_irq_duty_allows(const tx_frame_t *frame)
+{
+    uint32_t airtime = radio_irq_airtime(frame);
+
+    return tdma_slot_allows(airtime) &&
+           duty_allows(SX1272_GetFrequency(radio), SX1272_BW_HZ, airtime, HAL_GetTick());
+}
+
+// Keys the radio for txFrame in its class framing and books its airtime
+static bool radio_irq_transmit(void)
+{
+    radio_irq_use_class(txFrame->traffic_class);
+    if (SX1272_Transmit(radio, txFrame->data, txFrame->length) != HAL_OK)
+    {
+        radio_irq_use_class(rxClass);
+        return false;
+    }
+
+    duty_record(SX1272_GetFrequency(radio), SX1272_BW_HZ,
+                radio_irq_airtime(txFrame), HAL_GetTick());
+    return true;
+}
+
+// Starts txFrame, or listens first when LBT is on; an owned TDMA slot
+// needs no listening
+static bool radio_irq_send(void)
+{
+    if (lbt_enabled() && !tdma_active())
+    {
+        SX1272_StartCad(radio);
+        return true;
+    }
+    return radio_irq_transmit();
+}
+
+// Takes the next sendable frame and starts it; runs in the bottom half only
+static bool radio_irq_start_tx(void)
+{
+    txDeferred = false;
+    while ((txFrame = tx_queue_next(radio_irq_duty_allows)) != NULL)
+    {
+        txAttempt = 0;
+        if (radio_irq_send()) return true;
+
+        // Too long for the TX FIFO region: drop it rather than stall the queue
+        tx_queue_release(txFrame);
+    }
+
+    if (tx_queue_pending())
+    {
+        // Out of budget: look again when the oldest ledger slot expires.
+        // Frames held for their TDMA slot are kicked by the slot timer.
+        uint32_t now = HAL_GetTick();
+        txDeferUntil = now + duty_next_change(now);
+        txDeferred = true;
+    }
+    return false;
+}
+
+void radio_irq_init(sx1272_t *instance)
+{
+    radio = instance;
+    dio0Latched = false;
+    rxCommitted = false;
+    txFrame = NULL;
+    txBackoff = false;
+    txDeferred = false;
+    cycle_counter_init();
+    HAL_NVIC_SetPriority(PendSV_IRQn, RADIO_IRQ_BH_PRIORITY, 0);
+}
+
+void radio_irq_dio0(uint32_t tick)
+{
+    // Latch the cycle counter first: it is the precise arrival time
+    dio0Cycles = cycle_counter_read();
+    dio0Tick = tick;
+    dio0Latched = true;
+    radio_irq_pend();
+}
+
+void radio_irq_kick(void)
+{
+    radio_irq_pend();
+}
+
+void radio_irq_set_modem(const SX1272_ModemParams_t *params)
+{
+    radio_irq_lock();
+    modemNext = *params;
+    modemPending = true;
+    radio_irq_unlock();
+    radio_irq_pend();
+}
+
+void radio_irq_set_channel(uint8_t channel)
+{
+    channelNext = channel;
+    channelPending = true;
+    radio_irq_pend();
+}
+
+void radio_irq_set_class(uint8_t tclass, bool implicit, uint8_t length)
+{
+    if (tclass >= RADIO_CLASS_COUNT) return;
+
+    radio_irq_lock();
+    classes[tclass].implicit = implicit;
+    classes[tclass].length = length;
+    radio_irq_unlock();
+}
+
+void radio_irq_set_rx_class(uint8_t tclass)
+{
+    rxClass = tclass;
+    rxClassPending = true;
+    radio_irq_pend();
+}
+
+void radio_irq_poll(uint32_t now)
+{
+    if ((txBackoff && (int32_t)(now - txRetryAt) >= 0) ||
+        (txDeferred && (int32_t)(now - txDeferUntil) >= 0))
+    {
+        radio_irq_pend();
+    }
+}
+
+void radio_irq_bottom_half(void)
+{
+    // The event queue has one producer: frames committed from the DMA
+    // interrupt are announced here
+    if (rxCommitted)
+    {
+        rxCommitted = false;
+        radio_event_post(RADIO_EVT_RX_DONE, HAL_GetTick());
+    }
+
+    // A FIFO burst owns the bus; SX1272_BusIdleCallback() re-pends us
+    if (SX1272_IsDmaBusy(radio)) return;
+
+    if (dio0Latched)
+    {
+        if (!SX1272_HandleDIO0(radio, dio0Tick, dio0Cycles)) return;
+        dio0Latched = false;
+    }
+
+    // Reconfigure only between frames, once everything queued has gone out
+    if (modemPending && txFrame == NULL && !tx_queue_pending())
+    {
+        modemPending = false;
+        SX1272_SetModemParams(radio, &modemNext);
+        SX1272_Receive(radio);
+    }
+
+    if (rxClassPending && txFrame == NULL)
+    {
+        rxClassPending = false;
+        radio_irq_use_class(rxClass);
+        SX1272_WriteReg(radio, REG_OP_MODE, SX1272_MODE_STDBY | SX1272_MODE_LORA);
+        SX1272_Receive(radio);
+    }
+
+    if (channelPending && txFrame == NULL)
+    {
+        // One FRF burst, then re-enter RX so the receiver retunes
+        channelPending = false;
+        SX1272_SetFrf(radio, channel_plan_frf(channelNext), channel_plan_freq(channelNext));
+        SX1272_WriteReg(radio, REG_OP_MODE, SX1272_MODE_STDBY | SX1272_MODE_LORA);
+        SX1272_Receive(radio);
+    }
+
+    // Radio idle in RX: start a frame the application queued meanwhile
+    if (txFrame == NULL)
+    {
+        radio_irq_start_tx();
+    }
+    else if (txBackoff && (int32_t)(HAL_GetTick() - txRetryAt) >= 0)
+    {
+        // Backoff over: listen again
+        txBackoff = false;
+        SX1272_StartCad(radio);
+    }
+}
+
+void radio_irq_lock(void)
+{
+    __set_BASEPRI(RADIO_IRQ_BH_PRIORITY << (8U - __NVIC_PRIO_BITS));
+}
+
+void radio_irq_unlock(void)
+{
+    __set_BASEPRI(0);
+}
+
+// Called by the driver from the DMA interrupt when a FIFO burst ends
+void SX1272_BusIdleCallback(sx1272_t *instance)
+{
+    if (instance != radio) return;
+    if (dio0Latched || (txFrame == NULL && tx_queue_pending())) radio_irq_pend();
+}
+
+// Called by the driver when a received frame is in the RX ring, from the
+// bottom half or the DMA interrupt
+void SX1272_RxDoneCallback(sx1272_t *instance)
+{
+    if (instance != radio) return;
+    rxCommitted = true;
+    radio_irq_pend();
+}
+
+// Called by the driver inside SX1272_HandleDIO0() on TxDone
+bool SX1272_TxDoneCallback(sx1272_t *instance)
+{
+    if (instance != radio) return false;
+
+    if (txFrame != NULL)
+    {
+        tx_queue_release(txFrame);
+        radio_event_post(RADIO_EVT_TX_DONE, HAL_GetTick());
+    }
+    if (radio_irq_start_tx()) return true;
+
+    // Back to RX: listen with the framing of the receive class
+    radio_irq_use_class(rxClass);
+    return false;
+}
+
+// Called by the driver inside SX1272_HandleDIO0() on CadDone
+bool SX1272_CadDoneCallback(sx1272_t *instance, bool detected)
+{
+    if (instance != radio || txFrame == NULL) return false;
+
+    lbt_record_cad(detected);
+    if (!detected)
+    {
+        if (radio_irq_transmit()) return true;
+        tx_queue_release(txFrame);
+        return radio_irq_start_tx();
+    }
+
+    if (++txAttempt >= LBT_MAX_ATTEMPTS)
+    {
+        lbt_record_drop();
+        tx_queue_release(txFrame);
+        return radio_irq_start_tx();
+    }
+
+    // Channel busy: keep receiving until the backoff expires
+    txRetryAt = HAL_GetTick() + lbt_backoff(txAttempt);
+    txBackoff = true;
+    return false;
+}
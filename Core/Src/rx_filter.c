@@ -0,0 +1,96 @@
+#include "rx_filter.h"
+#include "keytable.h"
+#include "nonce.h"
+#include "frag.h"
+#include <string.h>
+
+static uint8_t filter_net_id;
+static uint8_t filter_local_addr;
+static rx_filter_stats_t filter_stats;
+
+void rx_filter_init(uint8_t net_id, uint8_t local_addr) {
+    filter_net_id = net_id;
+    filter_local_addr = local_addr;
+    rx_filter_reset_stats();
+}
+
+static rx_filter_result_t rx_filter_reject(rx_filter_result_t result) {
+    filter_stats.rejected[result]++;
+    return result;
+}
+
+rx_filter_result_t rx_filter_process(const uint8_t *frame, uint8_t frame_len,
+                                     lora_frame_header_t *header,
+                                     uint8_t *payload, uint8_t *payload_len) {
+    filter_stats.received++;
+
+    // 1. Network ID: one byte compare drops most foreign traffic.
+    //    A frame too short to carry it falls through to the length stage.
+    if (frame_len > FRAME_OFF_NET_ID && frame[FRAME_OFF_NET_ID] != filter_net_id) {
+        return rx_filter_reject(RX_FILTER_REJECT_NETWORK);
+    }
+
+    // 2. Destination address
+    if (frame_len > FRAME_OFF_DST &&
+        frame[FRAME_OFF_DST] != filter_local_addr &&
+        frame[FRAME_OFF_DST] != FRAME_ADDR_BROADCAST) {
+        return rx_filter_reject(RX_FILTER_REJECT_ADDRESS);
+    }
+
+    // 3. Length sanity: header and tag must fit, a fragment has no tag
+    bool fragment = frame_len > FRAME_OFF_TYPE && frame[FRAME_OFF_TYPE] == FRAME_TYPE_FRAGMENT;
+    if (frame_len < (fragment ? FRAG_FRAME_MIN : FRAME_OVERHEAD)) {
+        return rx_filter_reject(RX_FILTER_REJECT_LENGTH);
+    }
+
+    lora_frame_parse_header(frame, header);
+
+    // 4. Key selection from the header hint, no trial decryption
+    //    and the epoch bit picks the active or staged context
+    keytable_entry_t *key = keytable_lookup(header->src, header->key_hint);
+    const aes_gcm_ctx_t *ctx = (key != NULL) ? keytable_rx_ctx(key, header->key_hint) : NULL;
+    if (ctx == NULL) {
+        return rx_filter_reject(RX_FILTER_REJECT_KEY);
+    }
+
+    // 5. Replay window of the epoch (read-only until the tag verifies);
+    //    fragments are checked against the message counters only
+    nonce_window_t *window = keytable_rx_window(key, header->key_hint, fragment);
+    if (!nonce_window_check(window, header->counter)) {
+        // A repeated fragment of a finished message asks for our acknowledgement
+        if (fragment) frag_rx_replayed(header);
+        return rx_filter_reject(RX_FILTER_REJECT_REPLAY);
+    }
+
+    if (fragment) {
+        // 6. Fragments are only collected; the message is authenticated
+        //    once, when its last missing fragment arrives
+        if (!frag_rx_add(header, frame, frame_len)) {
+            filter_stats.fragments++;
+            return RX_FILTER_FRAGMENT;
+        }
+        if (!frag_rx_open(ctx, header)) {
+            return rx_filter_reject(RX_FILTER_REJECT_AUTH);
+        }
+        *payload_len = 0;
+    } else {
+        // 6. Full decrypt
+        if (!lora_frame_open(ctx, header, frame, frame_len, payload)) {
+            return rx_filter_reject(RX_FILTER_REJECT_AUTH);
+        }
+        *payload_len = frame_len - FRAME_OVERHEAD;
+    }
+
+    nonce_window_update(window, header->counter);
+    keytable_rx_confirm(key, header->key_hint);
+    filter_stats.accepted++;
+    return RX_FILTER_ACCEPT;
+}
+
+const rx_filter_stats_t *rx_filter_get_stats(void) {
+    return &filter_stats;
+}
+
+void rx_filter_reset_stats(void) {
+    memset(&filter_stats, 0, sizeof(filter_stats));
+}
@@ -0,0 +1,37 @@
+#include "rx_ring.h"
+
+/*
+ * head and tail run freely and are masked on access, so all RX_RING_SLOTS
+ * slots are usable: the ring is full when head - tail == RX_RING_SLOTS.
+ */
+
+void rx_ring_init(rx_ring_t *ring) {
+    ring->head = 0;
+    ring->tail = 0;
+    ring->dropped = 0;
+}
+
+rx_packet_t *rx_ring_claim(rx_ring_t *ring) {
+    if (ring->head - ring->tail >= RX_RING_SLOTS) {
+        ring->dropped++;
+        return NULL;
+    }
+    return &ring->slot[ring->head & (RX_RING_SLOTS - 1)];
+}
+
+void rx_ring_commit(rx_ring_t *ring) {
+    // Slot contents must be visible before the new head
+    __asm volatile ("" ::: "memory");
+    ring->head = ring->head + 1;
+}
+
+rx_packet_t *rx_ring_peek(rx_ring_t *ring) {
+    if (ring->tail == ring->head) return NULL;
+    __asm volatile ("" ::: "memory");
+    return &ring->slot[ring->tail & (RX_RING_SLOTS - 1)];
+}
+
+void rx_ring_release(rx_ring_t *ring) {
+    __asm volatile ("" ::: "memory");
+    ring->tail = ring->tail + 1;
+}
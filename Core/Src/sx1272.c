@@ -1,154 +1,713 @@
 #include "sx1272.h"
+#include "cycle_counter.h"
+#include "airtime.h"
 #include <string.h>
 
-uint8_t SX1272_RxBuffer[256];
-volatile uint8_t SX1272_RxLength = 0;
+#ifdef SX1272_USE_LL_SPI
+#include "stm32g4xx_ll_spi.h"
+#include "stm32g4xx_ll_gpio.h"
+#endif
 
-static void SX1272_Select(void)   { HAL_GPIO_WritePin(SX1272_NSS_PORT, SX1272_NSS_PIN, GPIO_PIN_RESET); }
-static void SX1272_Unselect(void) { HAL_GPIO_WritePin(SX1272_NSS_PORT, SX1272_NSS_PIN, GPIO_PIN_SET); }
+// Radios registered by SX1272_Init(), for the HAL SPI completion callbacks
+static sx1272_t *radios[SX1272_MAX_RADIOS];
 
-void SX1272_Reset(void)
+static const SX1272_ModemParams_t defaultModemParams = { 7, SX1272_CR_4_5, SX1272_POWER_MAX };
+
+static void SX1272_Select(sx1272_t *radio)   { HAL_GPIO_WritePin(radio->nssPort, radio->nssPin, GPIO_PIN_RESET); }
+static void SX1272_Unselect(sx1272_t *radio) { HAL_GPIO_WritePin(radio->nssPort, radio->nssPin, GPIO_PIN_SET); }
+
+static void SX1272_WaitDma(sx1272_t *radio)
+{
+    while (radio->dmaBusy) { }
+}
+
+#ifdef SX1272_USE_LL_SPI
+/*
+ * Two-byte register transaction on bare SPI registers: no handle state,
+ * locking or timeouts. Both bytes fit in the TX FIFO, and the RX FIFO
+ * threshold is one byte because HAL_SPI_Init() configured 8-bit frames.
+ */
+static uint8_t SX1272_LL_Transfer(sx1272_t *radio, uint8_t addr, uint8_t data)
+{
+    SPI_TypeDef *spi = radio->spi->Instance;
+    uint8_t value;
+
+    if (!LL_SPI_IsEnabled(spi)) LL_SPI_Enable(spi);
+    while (LL_SPI_GetRxFIFOLevel(spi) != LL_SPI_RX_FIFO_EMPTY) {
+        (void)LL_SPI_ReceiveData8(spi);
+    }
+
+    LL_GPIO_ResetOutputPin(radio->nssPort, radio->nssPin);
+    LL_SPI_TransmitData8(spi, addr);
+    LL_SPI_TransmitData8(spi, data);
+    while (!LL_SPI_IsActiveFlag_RXNE(spi)) { }
+    (void)LL_SPI_ReceiveData8(spi);
+    while (!LL_SPI_IsActiveFlag_RXNE(spi)) { }
+    value = LL_SPI_ReceiveData8(spi);
+    while (LL_SPI_IsActiveFlag_BSY(spi)) { }
+    LL_GPIO_SetOutputPin(radio->nssPort, radio->nssPin);
+
+    return value;
+}
+#endif
+
+// FIFO access, the auto-incrementing FIFO pointer and write-1-to-clear
+// IRQ flags must always reach the radio
+static bool SX1272_IsCacheable(uint8_t addr)
+{
+    return addr != REG_FIFO && addr != REG_FIFO_ADDR_PTR && addr != REG_IRQ_FLAGS;
+}
+
+static bool SX1272_ShadowMatches(sx1272_t *radio, uint8_t addr, uint8_t data)
+{
+    return SX1272_IsCacheable(addr) &&
+           (radio->shadowValid[addr >> 5] & (1UL << (addr & 31))) &&
+           radio->shadow[addr] == data;
+}
+
+static void SX1272_ShadowStore(sx1272_t *radio, uint8_t addr, uint8_t data)
+{
+    radio->shadow[addr] = data;
+    radio->shadowValid[addr >> 5] |= 1UL << (addr & 31);
+}
+
+void SX1272_ShadowInvalidate(sx1272_t *radio)
+{
+    memset(radio->shadowValid, 0, sizeof(radio->shadowValid));
+}
+
+const SX1272_ShadowStats_t *SX1272_GetShadowStats(const sx1272_t *radio)
+{
+    return &radio->shadowStats;
+}
+
+void SX1272_Reset(sx1272_t *radio)
 {
-    HAL_GPIO_WritePin(SX1272_RESET_PORT, SX1272_RESET_PIN, GPIO_PIN_RESET);
+    // Every register returns to its reset value
+    SX1272_ShadowInvalidate(radio);
+
+    HAL_GPIO_WritePin(radio->resetPort, radio->resetPin, GPIO_PIN_RESET);
     HAL_Delay(1); // >100 µs
-    HAL_GPIO_WritePin(SX1272_RESET_PORT, SX1272_RESET_PIN, GPIO_PIN_SET);
+    HAL_GPIO_WritePin(radio->resetPort, radio->resetPin, GPIO_PIN_SET);
     HAL_Delay(5); // >5 ms
 }
 
-void SX1272_WriteReg(uint8_t addr, uint8_t data)
+void SX1272_WriteReg(sx1272_t *radio, uint8_t addr, uint8_t data)
 {
-    addr |= 0x80; // MSB=1 for write
-    SX1272_Select();
-    HAL_SPI_Transmit(&hspi1, &addr, 1, HAL_MAX_DELAY);
-    HAL_SPI_Transmit(&hspi1, &data, 1, HAL_MAX_DELAY);
-    SX1272_Unselect();
+    addr &= 0x7F;
+    if (SX1272_ShadowMatches(radio, addr, data)) {
+        radio->shadowStats.skipped++;
+        return;
+    }
+
+    // Address (MSB=1 for write) and data in one transfer
+#ifdef SX1272_USE_LL_SPI
+    (void)SX1272_LL_Transfer(radio, addr | 0x80, data);
+#else
+    uint8_t frame[2] = { addr | 0x80, data };
+    SX1272_Select(radio);
+    HAL_SPI_Transmit(radio->spi, frame, 2, HAL_MAX_DELAY);
+    SX1272_Unselect(radio);
+#endif
+
+    radio->shadowStats.writes++;
+    if (SX1272_IsCacheable(addr)) SX1272_ShadowStore(radio, addr, data);
 }
 
-uint8_t SX1272_ReadReg(uint8_t addr)
+uint8_t SX1272_ReadReg(sx1272_t *radio, uint8_t addr)
 {
-    uint8_t value;
-    SX1272_Select();
-    HAL_SPI_Transmit(&hspi1, &addr, 1, HAL_MAX_DELAY);
-    HAL_SPI_Receive(&hspi1, &value, 1, HAL_MAX_DELAY);
-    SX1272_Unselect();
-    return value;
+    // The value is clocked out while the dummy second byte is sent
+#ifdef SX1272_USE_LL_SPI
+    return SX1272_LL_Transfer(radio, addr & 0x7F, 0x00);
+#else
+    uint8_t tx[2] = { addr & 0x7F, 0x00 };
+    uint8_t rx[2];
+    SX1272_Select(radio);
+    HAL_SPI_TransmitReceive(radio->spi, tx, rx, 2, HAL_MAX_DELAY);
+    SX1272_Unselect(radio);
+    return rx[1];
+#endif
+}
+
+void SX1272_WriteRegs(sx1272_t *radio, uint8_t addr, const uint8_t *values, uint8_t count)
+{
+    // The radio auto-increments the address, so a run of registers is one transfer
+    uint8_t frame[SX1272_BURST_MAX + 1];
+
+    if (count > SX1272_BURST_MAX) count = SX1272_BURST_MAX;
+    addr &= 0x7F;
+    // The register map and its shadow end at 0x7F
+    if (count > 0x80 - addr) count = 0x80 - addr;
+
+    // Skip the burst only if every register in the run already holds its value
+    uint8_t i;
+    for (i = 0; i < count; i++) {
+        if (!SX1272_ShadowMatches(radio, addr + i, values[i])) break;
+    }
+    if (i == count) {
+        radio->shadowStats.skipped++;
+        return;
+    }
+
+    frame[0] = addr | 0x80;
+    memcpy(&frame[1], values, count);
+
+    SX1272_Select(radio);
+    HAL_SPI_Transmit(radio->spi, frame, count + 1, HAL_MAX_DELAY);
+    SX1272_Unselect(radio);
+
+    radio->shadowStats.writes++;
+    for (i = 0; i < count; i++) {
+        if (SX1272_IsCacheable(addr + i)) SX1272_ShadowStore(radio, addr + i, values[i]);
+    }
+}
+
+void SX1272_ReadRegs(sx1272_t *radio, uint8_t addr, uint8_t *values, uint8_t count)
+{
+    uint8_t tx[SX1272_BURST_MAX + 1] = { 0 };
+    uint8_t rx[SX1272_BURST_MAX + 1];
+
+    if (count > SX1272_BURST_MAX) count = SX1272_BURST_MAX;
+    tx[0] = addr & 0x7F;
+
+    SX1272_Select(radio);
+    HAL_SPI_TransmitReceive(radio->spi, tx, rx, count + 1, HAL_MAX_DELAY);
+    SX1272_Unselect(radio);
+    memcpy(values, &rx[1], count);
+}
+
+void SX1272_WriteBuffer(sx1272_t *radio, uint8_t addr, uint8_t *buffer, uint8_t size)
+{
+    addr |= 0x80;
+    SX1272_Select(radio);
+    HAL_SPI_Transmit(radio->spi, &addr, 1, HAL_MAX_DELAY);
+    HAL_SPI_Transmit(radio->spi, buffer, size, HAL_MAX_DELAY);
+    SX1272_Unselect(radio);
+}
+
+void SX1272_ReadBuffer(sx1272_t *radio, uint8_t addr, uint8_t *buffer, uint8_t size)
+{
+    SX1272_Select(radio);
+    HAL_SPI_Transmit(radio->spi, &addr, 1, HAL_MAX_DELAY);
+    HAL_SPI_Receive(radio->spi, buffer, size, HAL_MAX_DELAY);
+    SX1272_Unselect(radio);
+}
+
+static bool SX1272_IsRegistered(const sx1272_t *radio)
+{
+    for (int i = 0; i < SX1272_MAX_RADIOS; i++)
+    {
+        if (radios[i] == radio) return true;
+    }
+    return false;
 }
 
-void SX1272_WriteBuffer(uint8_t addr, uint8_t *buffer, uint8_t size)
+// Makes the radio reachable from the SPI completion callbacks
+static void SX1272_Register(sx1272_t *radio)
 {
+    if (SX1272_IsRegistered(radio)) return;
+
+    for (int i = 0; i < SX1272_MAX_RADIOS; i++)
+    {
+        if (radios[i] == NULL)
+        {
+            radios[i] = radio;
+            return;
+        }
+    }
+}
+
+HAL_StatusTypeDef SX1272_WriteBufferDMA(sx1272_t *radio, uint8_t addr, uint8_t *buffer, uint8_t size, SX1272_DmaCallback done)
+{
+    if (radio->dmaBusy) return HAL_BUSY;
+    // Completion could not be routed back: callers fall back to blocking bursts
+    if (!SX1272_IsRegistered(radio)) return HAL_ERROR;
+
     addr |= 0x80;
-    SX1272_Select();
-    HAL_SPI_Transmit(&hspi1, &addr, 1, HAL_MAX_DELAY);
-    HAL_SPI_Transmit(&hspi1, buffer, size, HAL_MAX_DELAY);
-    SX1272_Unselect();
+    radio->dmaBusy = true;
+    radio->dmaDone = done;
+    SX1272_Select(radio);
+    HAL_SPI_Transmit(radio->spi, &addr, 1, HAL_MAX_DELAY);
+    if (HAL_SPI_Transmit_DMA(radio->spi, buffer, size) != HAL_OK) {
+        SX1272_Unselect(radio);
+        radio->dmaBusy = false;
+        return HAL_ERROR;
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef SX1272_ReadBufferDMA(sx1272_t *radio, uint8_t addr, uint8_t *buffer, uint8_t size, SX1272_DmaCallback done)
+{
+    if (radio->dmaBusy) return HAL_BUSY;
+    // Completion could not be routed back: callers fall back to blocking bursts
+    if (!SX1272_IsRegistered(radio)) return HAL_ERROR;
+
+    radio->dmaBusy = true;
+    radio->dmaDone = done;
+    SX1272_Select(radio);
+    HAL_SPI_Transmit(radio->spi, &addr, 1, HAL_MAX_DELAY);
+    if (HAL_SPI_Receive_DMA(radio->spi, buffer, size) != HAL_OK) {
+        SX1272_Unselect(radio);
+        radio->dmaBusy = false;
+        return HAL_ERROR;
+    }
+    return HAL_OK;
+}
+
+bool SX1272_IsDmaBusy(const sx1272_t *radio)
+{
+    return radio->dmaBusy;
 }
 
-void SX1272_ReadBuffer(uint8_t addr, uint8_t *buffer, uint8_t size)
+static void SX1272_DmaComplete(sx1272_t *radio)
+{
+    SX1272_DmaCallback done = radio->dmaDone;
+
+    SX1272_Unselect(radio);
+    radio->dmaDone = NULL;
+    radio->dmaBusy = false;
+    if (done != NULL) {
+        done(radio);
+    }
+    SX1272_BusIdleCallback(radio);
+}
+
+// Override to resume work that was deferred while a burst owned the bus
+__weak void SX1272_BusIdleCallback(sx1272_t *radio)
+{
+}
+
+// Override to hand a committed frame to the application
+__weak void SX1272_RxDoneCallback(sx1272_t *radio)
 {
-    SX1272_Select();
-    HAL_SPI_Transmit(&hspi1, &addr, 1, HAL_MAX_DELAY);
-    HAL_SPI_Receive(&hspi1, buffer, size, HAL_MAX_DELAY);
-    SX1272_Unselect();
 }
 
-void SX1272_SetFrequency(uint32_t freq) {
+// Override to chain the next transmission; return true if one was started
+__weak bool SX1272_TxDoneCallback(sx1272_t *radio)
+{
+    return false;
+}
+
+// Override to act on the CAD result; return true if the radio was kept busy
+__weak bool SX1272_CadDoneCallback(sx1272_t *radio, bool detected)
+{
+    return false;
+}
+
+// The radio whose burst just ended on this bus
+static sx1272_t *SX1272_FromSpi(SPI_HandleTypeDef *hspi)
+{
+    for (int i = 0; i < SX1272_MAX_RADIOS; i++)
+    {
+        if (radios[i] != NULL && radios[i]->spi == hspi && radios[i]->dmaBusy) return radios[i];
+    }
+    return NULL;
+}
+
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    sx1272_t *radio = SX1272_FromSpi(hspi);
+    if (radio != NULL) SX1272_DmaComplete(radio);
+}
+
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    sx1272_t *radio = SX1272_FromSpi(hspi);
+    if (radio != NULL) SX1272_DmaComplete(radio);
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    sx1272_t *radio = SX1272_FromSpi(hspi);
+    if (radio != NULL) {
+        // Drop the transfer; the callback is not run for a failed burst
+        SX1272_Unselect(radio);
+        radio->dmaDone = NULL;
+        radio->dmaBusy = false;
+        SX1272_BusIdleCallback(radio);
+    }
+}
+
+void SX1272_BenchmarkRegAccess(sx1272_t *radio, uint32_t iterations, SX1272_RegBench_t *result)
+{
+    uint32_t start, cycles;
+    uint8_t ptr;
+
+    SX1272_WaitDma(radio);
+    cycle_counter_init();
+
+    start = cycle_counter_read();
+    for (uint32_t i = 0; i < iterations; i++) {
+        (void)SX1272_ReadReg(radio, REG_VERSION);
+    }
+    cycles = cycle_counter_read() - start;
+    result->reads_per_sec = (uint32_t)(((uint64_t)iterations * SystemCoreClock) / (cycles ? cycles : 1));
+
+    // The FIFO pointer is never shadowed, so every write reaches the bus;
+    // writing back its own value leaves the radio untouched
+    ptr = SX1272_ReadReg(radio, REG_FIFO_ADDR_PTR);
+    start = cycle_counter_read();
+    for (uint32_t i = 0; i < iterations; i++) {
+        SX1272_WriteReg(radio, REG_FIFO_ADDR_PTR, ptr);
+    }
+    cycles = cycle_counter_read() - start;
+    result->writes_per_sec = (uint32_t)(((uint64_t)iterations * SystemCoreClock) / (cycles ? cycles : 1));
+}
+
+void SX1272_SetFrequency(sx1272_t *radio, uint32_t freq) {
 
     uint64_t frf = ((uint64_t)freq << 19) / 32000000;
+    uint8_t regs[3] = { (frf >> 16) & 0xFF, (frf >> 8) & 0xFF, frf & 0xFF };
+
+    SX1272_SetFrf(radio, regs, freq);
+}
+
+void SX1272_SetFrf(sx1272_t *radio, const uint8_t frf[3], uint32_t freq)
+{
+    // FRF_MSB/MID/LSB are adjacent: one burst
+    SX1272_WriteRegs(radio, REG_FRF_MSB, frf, 3);
+    radio->frequency = freq;
+}
+
+uint32_t SX1272_GetFrequency(const sx1272_t *radio)
+{
+    return radio->frequency;
+}
+
+uint32_t SX1272_TimeOnAir(const sx1272_t *radio, uint8_t size, bool implicit)
+{
+    airtime_params_t params = {
+        .sf              = radio->modemParams.sf,
+        .bw_hz           = SX1272_BW_HZ,
+        .cr              = radio->modemParams.cr,
+        .preamble        = SX1272_PREAMBLE_LENGTH,
+        .implicit_header = implicit,
+        .crc             = true,
+        .ldro            = radio->modemParams.sf >= 11,
+    };
+    return airtime_us(&params, size);
+}
+
+// MODEM_CONFIG1: Bw(7-6)=125kHz | CodingRate(5-3) | ImplicitHeaderModeOn(2) |
+// RxPayloadCrcOn(1) | LowDataRateOptimize(0), needed once a symbol exceeds
+// 16 ms (SF11 and SF12 at 125 kHz)
+static uint8_t SX1272_ModemConfig1(const sx1272_t *radio, const SX1272_ModemParams_t *p)
+{
+    return (p->cr << 3) | (radio->headerImplicit ? 0x04 : 0x00) | 0x02 | (p->sf >= 11 ? 0x01 : 0x00);
+}
+
+void SX1272_SetModemParams(sx1272_t *radio, const SX1272_ModemParams_t *params)
+{
+    SX1272_ModemParams_t p = *params;
+    uint8_t modemConfig[2];
+
+    if (p.sf < SX1272_SF_MIN) p.sf = SX1272_SF_MIN;
+    if (p.sf > SX1272_SF_MAX) p.sf = SX1272_SF_MAX;
+    if (p.cr < SX1272_CR_4_5) p.cr = SX1272_CR_4_5;
+    if (p.cr > SX1272_CR_4_8) p.cr = SX1272_CR_4_8;
+    if (p.power < SX1272_POWER_MIN) p.power = SX1272_POWER_MIN;
+    if (p.power > SX1272_POWER_MAX) p.power = SX1272_POWER_MAX;
 
-    // Write to frequency registers
-    SX1272_WriteReg(REG_FRF_MSB, (frf >> 16) & 0xFF);
-    SX1272_WriteReg(REG_FRF_MID, (frf >> 8)  & 0xFF);
-    SX1272_WriteReg(REG_FRF_LSB, frf & 0xFF);
+    modemConfig[0] = SX1272_ModemConfig1(radio, &p);
+    // MODEM_CONFIG2: SpreadingFactor(7-4) | AgcAutoOn(2)
+    modemConfig[1] = (p.sf << 4) | 0x04;
+
+    SX1272_WaitDma(radio);
+    SX1272_WriteReg(radio, REG_OP_MODE, SX1272_MODE_STDBY | SX1272_MODE_LORA);
+    SX1272_WriteRegs(radio, REG_MODEM_CONFIG1, modemConfig, sizeof(modemConfig));
+    SX1272_WriteReg(radio, REG_PA_CONFIG, (uint8_t)(p.power - SX1272_POWER_MIN) & 0x0F);
+
+    radio->modemParams = p;
+}
+
+void SX1272_SetHeaderMode(sx1272_t *radio, bool implicit, uint8_t length)
+{
+    SX1272_WaitDma(radio);
+
+    radio->headerImplicit = implicit;
+    radio->implicitLength = implicit ? length : 0;
+    SX1272_WriteReg(radio, REG_MODEM_CONFIG1, SX1272_ModemConfig1(radio, &radio->modemParams));
+
+    // Without a header the receiver takes the packet length from here
+    if (implicit)
+    {
+        SX1272_WriteReg(radio, REG_PAYLOAD_LENGTH, length);
+    }
 }
 
-void SX1272_SetupLora(void)
+const SX1272_ModemParams_t *SX1272_GetModemParams(const sx1272_t *radio)
+{
+    return &radio->modemParams;
+}
+
+void SX1272_SetupLora(sx1272_t *radio)
 {
     // Sleep then LoRa mode
-    SX1272_WriteReg(REG_OP_MODE, SX1272_MODE_SLEEP | SX1272_MODE_LORA);
+    SX1272_WriteReg(radio, REG_OP_MODE, SX1272_MODE_SLEEP | SX1272_MODE_LORA);
     HAL_Delay(10);
 
     // Standby
-    SX1272_WriteReg(REG_OP_MODE, SX1272_MODE_STDBY | SX1272_MODE_LORA);
+    SX1272_WriteReg(radio, REG_OP_MODE, SX1272_MODE_STDBY | SX1272_MODE_LORA);
 
-    SX1272_SetFrequency(868000000);
+    // 868.1 MHz: a 125 kHz channel at 868.0 MHz would straddle the
+    // h1.4/h1.5 sub-band edge
+    SX1272_SetFrequency(radio, SX1272_DEFAULT_FREQ);
 
-    // Base addresses
-    SX1272_WriteReg(REG_FIFO_TX_BASE_ADDR, 0x00);
-    SX1272_WriteReg(REG_FIFO_RX_BASE_ADDR, 0x00);
+    // Base addresses (TX, RX) and RX length limit for the FIFO layout
+    SX1272_SetFifoSplit(radio, radio->fifoSplit);
 
-    // Modem config (BW=125kHz, CR=4/5, SF=7)
-    SX1272_WriteReg(REG_MODEM_CONFIG1, 0x72);
-    SX1272_WriteReg(REG_MODEM_CONFIG2, 0x74);
+    // Modem config (BW=125kHz, CR=4/5, SF=7 unless changed since)
+    SX1272_SetModemParams(radio, &radio->modemParams);
 
 
     // Map DIO0: RxDone=00, TxDone=01 depending on mode
-    SX1272_WriteReg(REG_DIO_MAPPING1, 0x00);
+    SX1272_WriteReg(radio, REG_DIO_MAPPING1, 0x00);
 }
 
-void SX1272_Init(void)
+void SX1272_Init(sx1272_t *radio)
 {
-    SX1272_Reset();
-    SX1272_SetupLora();
+    radio->dmaBusy = false;
+    radio->dmaDone = NULL;
+    radio->txPending = 0;
+    radio->txPreloaded = false;
+    radio->txStartOnLoad = false;
+    radio->fifoSplit = false;
+    radio->frequency = 0;
+    radio->headerImplicit = false;
+    radio->implicitLength = 0;
+    radio->modemParams = defaultModemParams;
+    memset(&radio->shadowStats, 0, sizeof(radio->shadowStats));
+    SX1272_Register(radio);
+
+    rx_ring_init(&radio->rxRing);
+    SX1272_Reset(radio);
+    SX1272_SetupLora(radio);
 }
 
-void SX1272_Transmit(uint8_t *data, uint8_t size)
+void SX1272_SetFifoSplit(sx1272_t *radio, bool enable)
 {
-    // Map DIO0 to TxDone
-    SX1272_WriteReg(REG_DIO_MAPPING1, 0x40);
+    // Split: RX owns 0x00-0x7F and TX 0x80-0xFF. RegMaxPayloadLength caps
+    // one packet at 128 bytes; RX_CONT stores further packets after it, so
+    // SX1272_HandleDIO0() restarts RX at 0x00 after each one
+    const uint8_t fifoBase[2] = {
+        enable ? SX1272_FIFO_SPLIT_TX_BASE : 0x00,
+        0x00
+    };
 
-    SX1272_WriteReg(REG_OP_MODE, SX1272_MODE_STDBY | SX1272_MODE_LORA);
-    SX1272_WriteReg(REG_FIFO_ADDR_PTR, 0x00);
-    SX1272_WriteBuffer(REG_FIFO, data, size);
-    SX1272_WriteReg(REG_PAYLOAD_LENGTH, size);
+    SX1272_WaitDma(radio);
+    SX1272_WriteRegs(radio, REG_FIFO_TX_BASE_ADDR, fifoBase, sizeof(fifoBase));
+    SX1272_WriteReg(radio, REG_MAX_PAYLOAD_LENGTH, enable ? SX1272_FIFO_SPLIT_SIZE : 0xFF);
 
-    SX1272_WriteReg(REG_IRQ_FLAGS, 0xFF); // Clear all IRQs
-    SX1272_WriteReg(REG_OP_MODE, SX1272_MODE_TX | SX1272_MODE_LORA);
+    radio->fifoSplit = enable;
+    radio->txPreloaded = false;
 }
 
-void SX1272_Receive(void)
+// Runs from the DMA interrupt once the frame is in the radio FIFO
+static void SX1272_TxLoaded(sx1272_t *radio)
 {
+    SX1272_WriteReg(radio, REG_PAYLOAD_LENGTH, radio->txPending);
+    radio->txPreloaded = true;
+
+    if (radio->txStartOnLoad)
+    {
+        radio->txStartOnLoad = false;
+        SX1272_StartTx(radio);
+    }
+}
+
+static HAL_StatusTypeDef SX1272_LoadTx(sx1272_t *radio, uint8_t *data, uint8_t size, bool start)
+{
+    if (size == 0 || (radio->fifoSplit && size > SX1272_FIFO_SPLIT_SIZE)) return HAL_ERROR;
+    // The receiver expects exactly the configured length
+    if (radio->headerImplicit && size != radio->implicitLength) return HAL_ERROR;
+
+    SX1272_WaitDma(radio);
+
+    if (!radio->fifoSplit)
+    {
+        // Shared FIFO: RX must stop before its region is overwritten
+        SX1272_WriteReg(radio, REG_OP_MODE, SX1272_MODE_STDBY | SX1272_MODE_LORA);
+    }
+    SX1272_WriteReg(radio, REG_FIFO_ADDR_PTR, radio->fifoSplit ? SX1272_FIFO_SPLIT_TX_BASE : 0x00);
+
+    radio->txPending = size;
+    radio->txPreloaded = false;
+    radio->txStartOnLoad = start;
+    if (SX1272_WriteBufferDMA(radio, REG_FIFO, data, size, SX1272_TxLoaded) != HAL_OK) {
+        // Fall back to a blocking burst
+        SX1272_WriteBuffer(radio, REG_FIFO, data, size);
+        SX1272_TxLoaded(radio);
+    }
+    return HAL_OK;
+}
+
+// The caller must keep data unchanged until TxDone; the FIFO is filled by DMA
+HAL_StatusTypeDef SX1272_Transmit(sx1272_t *radio, uint8_t *data, uint8_t size)
+{
+    return SX1272_LoadTx(radio, data, size, true);
+}
+
+HAL_StatusTypeDef SX1272_PreloadTx(sx1272_t *radio, uint8_t *data, uint8_t size)
+{
+    // Without a split the FIFO belongs to RX until TX starts
+    if (!radio->fifoSplit) return HAL_ERROR;
+
+    return SX1272_LoadTx(radio, data, size, false);
+}
+
+HAL_StatusTypeDef SX1272_StartTx(sx1272_t *radio)
+{
+    if (!radio->txPreloaded) return radio->dmaBusy ? HAL_BUSY : HAL_ERROR;
+    radio->txPreloaded = false;
+
+    // Map DIO0 to TxDone
+    SX1272_WriteReg(radio, REG_DIO_MAPPING1, 0x40);
+
+    // With a split FIFO only TxDone is cleared, so an RxDone that landed
+    // during the preload is still serviced
+    SX1272_WriteReg(radio, REG_IRQ_FLAGS, radio->fifoSplit ? IRQ_TX_DONE_MASK : 0xFF);
+    SX1272_WriteReg(radio, REG_OP_MODE, SX1272_MODE_TX | SX1272_MODE_LORA);
+    return HAL_OK;
+}
+
+void SX1272_Receive(sx1272_t *radio)
+{
+    SX1272_WaitDma(radio);
+
     // Map DIO0 to RxDone
-    SX1272_WriteReg(REG_DIO_MAPPING1, 0x00);
+    SX1272_WriteReg(radio, REG_DIO_MAPPING1, 0x00);
+
+    SX1272_WriteReg(radio, REG_IRQ_FLAGS, 0xFF); // Clear all IRQs
+    SX1272_WriteReg(radio, REG_OP_MODE, SX1272_MODE_RX_CONT | SX1272_MODE_LORA);
+}
+
+void SX1272_StartCad(sx1272_t *radio)
+{
+    SX1272_WaitDma(radio);
+
+    // Map DIO0 to CadDone
+    SX1272_WriteReg(radio, REG_DIO_MAPPING1, 0x80);
 
-    SX1272_WriteReg(REG_IRQ_FLAGS, 0xFF); // Clear all IRQs
-    SX1272_WriteReg(REG_OP_MODE, SX1272_MODE_RX_CONT | SX1272_MODE_LORA);
+    SX1272_WriteReg(radio, REG_IRQ_FLAGS, IRQ_CAD_DONE_MASK | IRQ_CAD_DETECTED_MASK);
+    SX1272_WriteReg(radio, REG_OP_MODE, SX1272_MODE_CAD | SX1272_MODE_LORA);
 }
 
-void SX1272_HandleDIO0(void)
+uint32_t SX1272_ReadEntropy(sx1272_t *radio)
 {
-    uint8_t irqFlags = SX1272_ReadReg(REG_IRQ_FLAGS);
+    uint32_t value = 0;
+
+    // Only the LSB of the wideband RSSI is noise
+    for (int i = 0; i < 32; i++)
+    {
+        value = (value << 1) | (SX1272_ReadReg(radio, REG_RSSI_WIDEBAND) & 0x01);
+    }
+    return value;
+}
+
+// FEI is a 20-bit two's complement value;
+// error = FEI * 2^24 / F_XOSC * BW / 500 kHz
+static int32_t SX1272_FeiToHz(uint8_t msb, uint8_t mid, uint8_t lsb)
+{
+    int32_t fei = ((int32_t)(msb & 0x0F) << 16) | ((int32_t)mid << 8) | lsb;
+
+    if (fei & 0x80000) fei -= 0x100000;
+    return (int32_t)(((int64_t)fei * (1 << 24) * (SX1272_BW_HZ / 1000)) / (32000000LL * 500));
+}
+
+// Runs from the DMA interrupt once the payload is in the claimed ring slot
+static void SX1272_RxLoaded(sx1272_t *radio)
+{
+    rx_ring_commit(&radio->rxRing);
+    SX1272_RxDoneCallback(radio);
+}
+
+bool SX1272_HandleDIO0(sx1272_t *radio, uint32_t tick, uint32_t cycles)
+{
+    // A burst is still on the bus; the flags stay set, the caller retries later
+    if (radio->dmaBusy) return false;
+
+    uint8_t irqFlags = SX1272_ReadReg(radio, REG_IRQ_FLAGS);
 
     // Always clear ALL interrupts first
-    SX1272_WriteReg(REG_IRQ_FLAGS, 0xFF);  // Clear all flags
+    SX1272_WriteReg(radio, REG_IRQ_FLAGS, 0xFF);  // Clear all flags
 
     if (irqFlags & IRQ_RX_DONE_MASK)
     {
+        // Split FIFO: RX_CONT stores the next packet after this one, whether
+        // it was good or not, and would run into a preloaded frame. Entering
+        // RX again rewinds the write pointer to 0x00. The FIFO keeps its
+        // contents in standby, and a new payload needs a preamble and header
+        // on air before it lands, long after this packet has been read.
+        if (radio->fifoSplit && SX1272_ShadowMatches(radio, REG_OP_MODE, SX1272_MODE_RX_CONT | SX1272_MODE_LORA))
+        {
+            SX1272_WriteReg(radio, REG_OP_MODE, SX1272_MODE_STDBY | SX1272_MODE_LORA);
+            SX1272_WriteReg(radio, REG_OP_MODE, SX1272_MODE_RX_CONT | SX1272_MODE_LORA);
+        }
+
         if (!(irqFlags & IRQ_CRC_ERROR_MASK))
         {
-            // 1. Get payload length FIRST
-            SX1272_RxLength = SX1272_ReadReg(REG_RX_NB_BYTES);
+            // 1. Packet registers from FIFO_RX_CURRENT to FEI_LSB in one burst
+            uint8_t meta[REG_FEI_LSB - REG_FIFO_RX_CURRENT + 1];
+            SX1272_ReadRegs(radio, REG_FIFO_RX_CURRENT, meta, sizeof(meta));
+#define META(reg) meta[(reg) - REG_FIFO_RX_CURRENT]
 
-            // 2. Get current FIFO address
-            uint8_t currentAddr = SX1272_ReadReg(REG_FIFO_RX_CURRENT);
+            // Without a header the length is the configured one
+            uint8_t length = radio->headerImplicit ? radio->implicitLength : META(REG_RX_NB_BYTES);
 
-            // 3. Set FIFO pointer
-            SX1272_WriteReg(REG_FIFO_ADDR_PTR, currentAddr);
+            // 2. Claim a slot; if the application is behind, the frame is
+            //    dropped here and counted by the ring
+            rx_packet_t *slot = (length > 0) ? rx_ring_claim(&radio->rxRing) : NULL;
+            if (slot != NULL)
+            {
+                int8_t snr = (int8_t)META(REG_PKT_SNR_VALUE) / 4;
+                int16_t rssi = SX1272_RSSI_OFFSET + META(REG_PKT_RSSI_VALUE);
 
-            // 4. Read FIFO
-            if(SX1272_RxLength > 0 && SX1272_RxLength <= 256) {
-                SX1272_ReadBuffer(REG_FIFO, SX1272_RxBuffer, SX1272_RxLength);
-            }
+                // 3. Link metadata. Below the noise floor the RSSI register
+                //    misses the SNR, so add it back.
+                slot->length = length;
+                slot->snr = snr;
+                slot->rssi = (snr < 0) ? rssi + snr : rssi;
+                slot->freq_error = SX1272_FeiToHz(META(REG_FEI_MSB), META(REG_FEI_MSB + 1), META(REG_FEI_LSB));
+                slot->timestamp = tick;
+                slot->cycles = cycles;
 
-            // Optional: Null terminate if needed
-            if (SX1272_RxLength < 255) {
-                SX1272_RxBuffer[SX1272_RxLength] = '\0';
+                // 4. Point the FIFO at the packet
+                SX1272_WriteReg(radio, REG_FIFO_ADDR_PTR, META(REG_FIFO_RX_CURRENT));
+#undef META
+
+                // 5. Read the FIFO straight into the slot, committed on completion
+                if (SX1272_ReadBufferDMA(radio, REG_FIFO, slot->data, length, SX1272_RxLoaded) != HAL_OK)
+                {
+                    SX1272_ReadBuffer(radio, REG_FIFO, slot->data, length);
+                    SX1272_RxLoaded(radio);
+                }
             }
         }
     }
-    else if (irqFlags & IRQ_TX_DONE_MASK)
+
+    // Not exclusive: with a split FIFO an RxDone may still be pending at TxDone
+    if (irqFlags & IRQ_TX_DONE_MASK)
     {
-        // Immediately return to RX mode after TX
-        SX1272_Receive();
+        // The radio drops to standby by itself after TxDone
+        SX1272_ShadowStore(radio, REG_OP_MODE, SX1272_MODE_STDBY | SX1272_MODE_LORA);
+
+        // Start the next queued frame right away, otherwise return to RX
+        if (!SX1272_TxDoneCallback(radio))
+        {
+            SX1272_Receive(radio);
+        }
     }
-}
 
+    if (irqFlags & IRQ_CAD_DONE_MASK)
+    {
+        // CAD also ends in standby
+        SX1272_ShadowStore(radio, REG_OP_MODE, SX1272_MODE_STDBY | SX1272_MODE_LORA);
+
+        if (!SX1272_CadDoneCallback(radio, (irqFlags & IRQ_CAD_DETECTED_MASK) != 0))
+        {
+            SX1272_Receive(radio);
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,246 @@
+#include "tdma.h"
+#include "radio_irq.h"
+#include "stm32g4xx_hal.h"
+#include <string.h>
+
+#define TDMA_NO_SLOT 0xFF
+
+static bool active = false;
+static bool synced = false;
+static bool gateway = false;
+static uint8_t localAddr;
+static uint8_t ownSlot = TDMA_NO_SLOT;
+static tdma_beacon_t layout;
+
+// Superframe syncSeq started at syncStart; later ones are extrapolated
+static uint32_t syncStart;
+static uint32_t syncSeq;
+static uint32_t nextSf;            // Superframe of the armed own slot
+static uint32_t beaconSf;          // Last superframe a beacon was handed out for
+
+static volatile bool slotOpen = false;
+static uint32_t slotOpenAt;
+static volatile uint32_t slotCloseAt;
+
+static uint32_t tdma_period_us(void) {
+    return (uint32_t)layout.period_ms * 1000;
+}
+
+static void tdma_arm(uint32_t at) {
+    TIM2->CCR1 = at;
+    TIM2->SR = ~TIM_SR_CC1IF;
+    TIM2->DIER |= TIM_DIER_CC1IE;
+    // Already due: raise the compare event by software instead of waiting a wrap
+    if ((int32_t)(at - TIM2->CNT) <= 0) TIM2->EGR = TIM_EGR_CC1G;
+}
+
+static void tdma_disarm(void) {
+    TIM2->DIER &= ~TIM_DIER_CC1IE;
+    slotOpen = false;
+}
+
+// Arms the own slot of superframe nextSf
+static void tdma_schedule(void) {
+    uint32_t slot_us = (uint32_t)layout.slot_ms * 1000;
+
+    if (ownSlot == TDMA_NO_SLOT) {
+        tdma_disarm();
+        return;
+    }
+    if (gateway) {
+        // The gateway's own clock defines the grid: move the anchor along
+        syncStart += (nextSf - syncSeq) * tdma_period_us();
+        syncSeq = nextSf;
+    } else if (nextSf - syncSeq > TDMA_BEACON_LOSS_MAX) {
+        // Drift can no longer be bounded: stay silent until the next beacon
+        synced = false;
+        tdma_disarm();
+        return;
+    }
+
+    uint32_t start = syncStart + (nextSf - syncSeq) * tdma_period_us() + ownSlot * slot_us;
+    uint32_t guard = gateway ? TDMA_GUARD_MIN_US : tdma_guard_us(start + slot_us - syncStart);
+
+    if (2 * guard >= slot_us) {
+        // Slot too short for the accumulated drift: skip it
+        nextSf++;
+        tdma_schedule();
+        return;
+    }
+    slotOpenAt = start + guard;
+    slotCloseAt = start + slot_us - guard;
+    tdma_arm(slotOpenAt);
+}
+
+void tdma_timer_init(void) {
+    uint32_t clock = HAL_RCC_GetPCLK1Freq();
+
+    // Timers run at twice PCLK1 when the APB1 prescaler divides
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1) clock *= 2;
+
+    __HAL_RCC_TIM2_CLK_ENABLE();
+    TIM2->CR1 = 0;
+    TIM2->PSC = clock / 1000000 - 1;
+    TIM2->ARR = 0xFFFFFFFF;
+    TIM2->CCMR1 = 0;               // CC1 as output compare, frozen: interrupt only
+    TIM2->DIER = 0;
+    TIM2->EGR = TIM_EGR_UG;        // Load the prescaler
+    TIM2->SR = 0;
+
+    HAL_NVIC_SetPriority(TIM2_IRQn, TDMA_TIMER_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(TIM2_IRQn);
+    TIM2->CR1 = TIM_CR1_CEN;
+}
+
+uint32_t tdma_now_us(void) {
+    return TIM2->CNT;
+}
+
+void tdma_init(uint8_t local_addr) {
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    localAddr = local_addr;
+    active = true;
+    synced = false;
+    gateway = false;
+    ownSlot = TDMA_NO_SLOT;
+    tdma_disarm();
+    __set_PRIMASK(primask);
+}
+
+static uint8_t tdma_find_slot(void) {
+    for (uint8_t i = 0; i < layout.slot_count; i++) {
+        if (layout.owner[i] == localAddr) return i;
+    }
+    return TDMA_NO_SLOT;
+}
+
+void tdma_gateway_start(const tdma_beacon_t *beacon) {
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    layout = *beacon;
+    gateway = true;
+    synced = true;
+    ownSlot = tdma_find_slot();
+    // First superframe starts one period from now, leaving time to queue its beacon
+    syncSeq = beacon->seq;
+    syncStart = tdma_now_us() + tdma_period_us();
+    nextSf = syncSeq;
+    beaconSf = syncSeq - 1;
+    tdma_schedule();
+    __set_PRIMASK(primask);
+}
+
+void tdma_on_beacon(const tdma_beacon_t *beacon, uint32_t start_us) {
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    layout = *beacon;
+    // The gateway keys the beacon TDMA_GUARD_MIN_US into slot 0
+    syncStart = start_us - TDMA_GUARD_MIN_US;
+    syncSeq = beacon->seq;
+    synced = true;
+    ownSlot = tdma_find_slot();
+
+    // Own slot of this superframe, or the next one if it has already passed
+    tdma_disarm();
+    nextSf = syncSeq;
+    tdma_schedule();
+    if (synced && ownSlot != TDMA_NO_SLOT && (int32_t)(slotCloseAt - tdma_now_us()) <= 0) {
+        nextSf++;
+        tdma_schedule();
+    }
+    __set_PRIMASK(primask);
+}
+
+bool tdma_active(void) {
+    return active;
+}
+
+bool tdma_slot_allows(uint32_t airtime_us) {
+    if (!active) return true;
+    if (!synced || !slotOpen) return false;
+
+    return (int32_t)(slotCloseAt - (tdma_now_us() + airtime_us)) >= 0;
+}
+
+uint32_t tdma_superframe(void) {
+    uint32_t primask = __get_PRIMASK();
+    uint32_t sf;
+
+    __disable_irq();
+    sf = (layout.period_ms == 0) ? syncSeq :
+         syncSeq + (uint32_t)((int32_t)(tdma_now_us() - syncStart) / (int32_t)tdma_period_us());
+    __set_PRIMASK(primask);
+    return sf;
+}
+
+bool tdma_beacon_due(tdma_beacon_t *beacon) {
+    uint32_t primask = __get_PRIMASK();
+    bool due = false;
+
+    __disable_irq();
+    if (gateway && ownSlot == 0 && beaconSf != nextSf) {
+        beaconSf = nextSf;
+        *beacon = layout;
+        beacon->seq = nextSf;
+        due = true;
+    }
+    __set_PRIMASK(primask);
+    return due;
+}
+
+uint32_t tdma_guard_us(uint32_t since_sync_us) {
+    // Both clocks may drift TDMA_CLOCK_PPM in opposite directions
+    return TDMA_GUARD_MIN_US + (uint32_t)(((uint64_t)since_sync_us * 2 * TDMA_CLOCK_PPM) / 1000000);
+}
+
+uint8_t tdma_beacon_encode(const tdma_beacon_t *beacon, uint8_t *payload) {
+    uint8_t count = beacon->slot_count > TDMA_MAX_SLOTS ? TDMA_MAX_SLOTS : beacon->slot_count;
+
+    payload[0] = (beacon->seq >> 24) & 0xFF;
+    payload[1] = (beacon->seq >> 16) & 0xFF;
+    payload[2] = (beacon->seq >> 8) & 0xFF;
+    payload[3] = beacon->seq & 0xFF;
+    payload[4] = beacon->period_ms >> 8;
+    payload[5] = beacon->period_ms & 0xFF;
+    payload[6] = beacon->slot_ms >> 8;
+    payload[7] = beacon->slot_ms & 0xFF;
+    payload[8] = count;
+    memcpy(&payload[TDMA_BEACON_HEADER], beacon->owner, count);
+    return TDMA_BEACON_HEADER + count;
+}
+
+bool tdma_beacon_decode(const uint8_t *payload, uint8_t len, tdma_beacon_t *beacon) {
+    if (len < TDMA_BEACON_HEADER) return false;
+
+    beacon->seq = ((uint32_t)payload[0] << 24) | ((uint32_t)payload[1] << 16) |
+                  ((uint32_t)payload[2] << 8) | payload[3];
+    beacon->period_ms = ((uint16_t)payload[4] << 8) | payload[5];
+    beacon->slot_ms = ((uint16_t)payload[6] << 8) | payload[7];
+    beacon->slot_count = payload[8];
+
+    if (beacon->slot_count > TDMA_MAX_SLOTS || len < TDMA_BEACON_HEADER + beacon->slot_count) return false;
+    if (beacon->slot_ms == 0 || (uint32_t)beacon->slot_ms * beacon->slot_count > beacon->period_ms) return false;
+
+    memcpy(beacon->owner, &payload[TDMA_BEACON_HEADER], beacon->slot_count);
+    return true;
+}
+
+void tdma_timer_irq(void) {
+    if (!(TIM2->SR & TIM_SR_CC1IF)) return;
+    TIM2->SR = ~TIM_SR_CC1IF;
+
+    if (!slotOpen) {
+        // Slot begins: let the radio bottom half send what fits
+        slotOpen = true;
+        tdma_arm(slotCloseAt);
+        radio_irq_kick();
+    } else {
+        slotOpen = false;
+        nextSf++;
+        tdma_schedule();
+    }
+}
@@ -0,0 +1,60 @@
+#include "timer_wheel.h"
+#include <stddef.h>
+
+static void timer_wheel_unlink(timer_wheel_timer_t *timer) {
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->next = NULL;
+    timer->prev = NULL;
+}
+
+void timer_wheel_init(timer_wheel_t *wheel, uint32_t tick_ms, uint32_t now) {
+    for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+        wheel->bucket[i].next = &wheel->bucket[i];
+        wheel->bucket[i].prev = &wheel->bucket[i];
+    }
+    wheel->tick = 0;
+    wheel->tick_ms = tick_ms;
+    wheel->tick_start = now;
+}
+
+void timer_wheel_start(timer_wheel_t *wheel, timer_wheel_timer_t *timer, uint32_t delay_ms) {
+    // The current tick is partly gone: round up and add it
+    uint32_t ticks = (delay_ms + wheel->tick_ms - 1) / wheel->tick_ms + 1;
+    timer_wheel_timer_t *head;
+
+    timer_wheel_stop(timer);
+    timer->expires = wheel->tick + ticks;
+
+    head = &wheel->bucket[timer->expires & (TIMER_WHEEL_SLOTS - 1)];
+    timer->next = head;
+    timer->prev = head->prev;
+    head->prev->next = timer;
+    head->prev = timer;
+}
+
+void timer_wheel_stop(timer_wheel_timer_t *timer) {
+    if (timer->next != NULL) timer_wheel_unlink(timer);
+}
+
+bool timer_wheel_running(const timer_wheel_timer_t *timer) {
+    return timer->next != NULL;
+}
+
+timer_wheel_timer_t *timer_wheel_expire(timer_wheel_t *wheel, uint32_t now) {
+    for (;;) {
+        timer_wheel_timer_t *head = &wheel->bucket[wheel->tick & (TIMER_WHEEL_SLOTS - 1)];
+
+        for (timer_wheel_timer_t *timer = head->next; timer != head; timer = timer->next) {
+            // Later revolutions stay in the bucket
+            if ((int32_t)(timer->expires - wheel->tick) <= 0) {
+                timer_wheel_unlink(timer);
+                return timer;
+            }
+        }
+
+        if (now - wheel->tick_start < wheel->tick_ms) return NULL;
+        wheel->tick_start += wheel->tick_ms;
+        wheel->tick++;
+    }
+}
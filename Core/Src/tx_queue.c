@@ -0,0 +1,79 @@
+#include "tx_queue.h"
+#include "stm32g4xx.h"
+
+/*
+ * The application allocates and submits frames from thread mode while the
+ * radio bottom half takes them from PendSV. The slot scans are short, so
+ * they simply run with interrupts masked.
+ */
+static tx_frame_t frames[TX_QUEUE_SIZE];
+static uint32_t nextSeq;
+
+void tx_queue_init(void) {
+    for (int i = 0; i < TX_QUEUE_SIZE; i++) {
+        frames[i].state = TX_FRAME_FREE;
+    }
+    nextSeq = 0;
+}
+
+tx_frame_t *tx_queue_alloc(void) {
+    tx_frame_t *frame = NULL;
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    for (int i = 0; i < TX_QUEUE_SIZE; i++) {
+        if (frames[i].state == TX_FRAME_FREE) {
+            frame = &frames[i];
+            frame->state = TX_FRAME_FILLING;
+            frame->traffic_class = 0;
+            break;
+        }
+    }
+    __set_PRIMASK(primask);
+    return frame;
+}
+
+void tx_queue_submit(tx_frame_t *frame, uint8_t length, tx_priority_t priority) {
+    uint32_t primask = __get_PRIMASK();
+
+    frame->length = length;
+    frame->priority = (uint8_t)priority;
+
+    __disable_irq();
+    frame->seq = nextSeq++;
+    frame->state = TX_FRAME_QUEUED;
+    __set_PRIMASK(primask);
+}
+
+tx_frame_t *tx_queue_next(tx_queue_filter_t allow) {
+    tx_frame_t *best = NULL;
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    for (int i = 0; i < TX_QUEUE_SIZE; i++) {
+        tx_frame_t *frame = &frames[i];
+
+        if (frame->state != TX_FRAME_QUEUED) continue;
+        if (best != NULL && frame->priority > best->priority) continue;
+        if (allow != NULL && !allow(frame)) continue;
+        // Signed difference keeps FIFO order across seq wrap-around
+        if (best == NULL || frame->priority < best->priority ||
+            (frame->priority == best->priority && (int32_t)(frame->seq - best->seq) < 0)) {
+            best = frame;
+        }
+    }
+    if (best != NULL) best->state = TX_FRAME_SENDING;
+    __set_PRIMASK(primask);
+    return best;
+}
+
+void tx_queue_release(tx_frame_t *frame) {
+    frame->state = TX_FRAME_FREE;
+}
+
+bool tx_queue_pending(void) {
+    for (int i = 0; i < TX_QUEUE_SIZE; i++) {
+        if (frames[i].state == TX_FRAME_QUEUED) return true;
+    }
+    return false;
+}
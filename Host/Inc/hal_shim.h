@@ -0,0 +1,90 @@
+#ifndef HAL_SHIM_H
+#define HAL_SHIM_H
+
+#include "stm32g4xx_hal.h"
+#include "sx1272_model.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Host implementation of the HAL calls made by the radio driver.
+ *
+ * Time is virtual: it advances by the bus time of every SPI call, by
+ * HAL_Delay() and by hal_shim_advance_ns()/hal_shim_idle(), never by host
+ * CPU time. SPI bytes go to the model whose NSS pin is low on that bus; a
+ * low level on its reset pin resets the model. Model events and timers are
+ * run in time order from a heap, and a rising DIO0 calls
+ * HAL_GPIO_EXTI_Callback() with the attached DIO0 pin, as the EXTI
+ * interrupt would.
+ *
+ * Code running inside an event (EXTI callback, timer) runs on its own MCU:
+ * its SPI time delays only what it starts itself, and the shared clock is
+ * rewound when it returns. Many radios attached to one shim therefore
+ * behave like radios on separate boards.
+ */
+
+#define HAL_SHIM_HCLK_HZ        84000000U
+#define HAL_SHIM_PCLK_HZ        84000000U
+#define HAL_SHIM_SPI_CALL_NS    1500      // HAL entry, NSS and FIFO handling per SPI call
+
+typedef struct {
+    uint32_t spi_calls;          // HAL_SPI_* calls, DMA included
+    uint32_t spi_transactions;   // NSS low to high
+    uint32_t spi_bytes;
+    uint64_t spi_busy_ns;        // Bus time spent in SPI calls
+    uint32_t dio0_edges;
+} hal_shim_stats_t;
+
+typedef void (*hal_shim_timer_fn)(void *arg);
+
+/**
+ * @brief Connects a model to a SPI bus and pins.
+ *
+ * @param dio0_pin Pin number passed to HAL_GPIO_EXTI_Callback().
+ */
+void hal_shim_attach(sx1272_model_t *model, SPI_HandleTypeDef *spi,
+                     GPIO_TypeDef *nss_port, uint16_t nss_pin,
+                     GPIO_TypeDef *reset_port, uint16_t reset_pin, uint16_t dio0_pin);
+
+/**
+ * @brief Re-reads the model's next event after it was changed directly,
+ *        e.g. by sx1272_model_deliver().
+ */
+void hal_shim_schedule(sx1272_model_t *model);
+
+/**
+ * @brief Runs fn(arg) at the given virtual time, as an interrupt would.
+ */
+void hal_shim_call_at(uint64_t at_ns, hal_shim_timer_fn fn, void *arg);
+
+/**
+ * @brief Model whose event is running, e.g. inside HAL_GPIO_EXTI_Callback(); NULL otherwise.
+ */
+sx1272_model_t *hal_shim_current(void);
+
+/**
+ * @brief Current virtual time in nanoseconds.
+ */
+uint64_t hal_shim_now_ns(void);
+
+/**
+ * @brief Moves the virtual clock forward, running events on the way.
+ */
+void hal_shim_advance_ns(uint64_t ns);
+
+/**
+ * @brief Jumps to the next event and runs it, like WFI.
+ *
+ * @return false Nothing is scheduled; the clock did not move.
+ */
+bool hal_shim_idle(void);
+
+/**
+ * @brief Time of the next event, UINT64_MAX if none.
+ */
+uint64_t hal_shim_next_ns(void);
+
+const hal_shim_stats_t *hal_shim_get_stats(void);
+void hal_shim_reset_stats(void);
+
+#endif /* HAL_SHIM_H */
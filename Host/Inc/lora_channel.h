@@ -0,0 +1,70 @@
+#ifndef LORA_CHANNEL_H
+#define LORA_CHANNEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Shared-medium model of one LoRa channel as seen by the gateway.
+ *
+ * Path loss is log-distance, calibrated to Okumura-Hata urban at 868 MHz
+ * (15 m gateway, 1.5 m node): PL = 128.95 + 35.2 * log10(d / 1 km) dB.
+ * A packet is lost if it arrives below the sensitivity of its spreading
+ * factor. Spreading factors are only quasi-orthogonal: each overlapping
+ * packet must stay below the co-channel rejection of the SF pair (Croce et
+ * al., 2018). The same SF needs LORA_CHANNEL_CAPTURE_DB, so the stronger
+ * of two colliding packets may still be captured.
+ */
+
+#define LORA_CHANNEL_TX_POWER_DBM   14
+#define LORA_CHANNEL_NOISE_DBM      (-117)   // -174 + 10 log10(125 kHz) + 6 dB NF
+#define LORA_CHANNEL_PL_1KM_DB      128.95
+#define LORA_CHANNEL_PL_EXPONENT    3.52
+#define LORA_CHANNEL_CAPTURE_DB     6
+
+typedef enum {
+    LORA_CHANNEL_DELIVERED,
+    LORA_CHANNEL_WEAK,           // Below sensitivity
+    LORA_CHANNEL_COLLIDED        // Interference above the SIR threshold
+} lora_channel_outcome_t;
+
+/**
+ * @brief One transmission, kept until nothing on air can overlap it.
+ */
+typedef struct {
+    uint64_t start;              // ns
+    uint64_t end;
+    float    rssi;               // At the gateway, dBm
+    uint8_t  sf;
+    uint32_t id;                 // Caller's handle
+} lora_channel_tx_t;
+
+typedef struct {
+    lora_channel_tx_t *tx;
+    size_t   head;               // Oldest record
+    size_t   count;              // Records from head on
+    size_t   capacity;
+    uint64_t longest;            // Longest airtime seen, bounds the overlap search
+} lora_channel_t;
+
+double lora_channel_path_loss_db(double distance_m);
+int16_t lora_channel_sensitivity_dbm(uint8_t sf);
+int8_t lora_channel_sir_db(uint8_t sf, uint8_t interferer_sf);
+
+void lora_channel_init(lora_channel_t *channel);
+void lora_channel_free(lora_channel_t *channel);
+
+/**
+ * @brief Puts a transmission on the channel; call at its start.
+ */
+void lora_channel_begin(lora_channel_t *channel, const lora_channel_tx_t *tx);
+
+/**
+ * @brief Decides the fate of a transmission; call at its end.
+ *
+ * @param id Handle given to lora_channel_begin().
+ */
+lora_channel_outcome_t lora_channel_resolve(const lora_channel_t *channel, uint32_t id);
+
+#endif /* LORA_CHANNEL_H */
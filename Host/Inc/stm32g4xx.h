@@ -0,0 +1,51 @@
+#ifndef STM32G4XX_H
+#define STM32G4XX_H
+
+/*
+ * Host stand-in for the CMSIS device header: just the core registers and
+ * intrinsics the firmware modules touch. The cycle counter follows the
+ * virtual clock of hal_shim.c.
+ */
+
+#include <stdint.h>
+
+#define __NVIC_PRIO_BITS  4
+
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct {
+    volatile uint32_t ICSR;
+} SCB_Type;
+
+extern DWT_Type hal_shim_dwt;
+extern CoreDebug_Type hal_shim_core_debug;
+extern SCB_Type hal_shim_scb;
+extern uint32_t SystemCoreClock;
+
+#define DWT        (&hal_shim_dwt)
+#define CoreDebug  (&hal_shim_core_debug)
+#define SCB        (&hal_shim_scb)
+
+#define DWT_CTRL_CYCCNTENA_Msk         (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk     (1UL << 24)
+#define SCB_ICSR_PENDSVSET_Msk         (1UL << 28)
+
+// Interrupts are not preempted on the host: the masks are only recorded
+extern uint32_t hal_shim_primask;
+extern uint32_t hal_shim_basepri;
+
+static inline uint32_t __get_PRIMASK(void) { return hal_shim_primask; }
+static inline void __set_PRIMASK(uint32_t mask) { hal_shim_primask = mask; }
+static inline void __disable_irq(void) { hal_shim_primask = 1; }
+static inline void __enable_irq(void) { hal_shim_primask = 0; }
+static inline void __set_BASEPRI(uint32_t value) { hal_shim_basepri = value; }
+static inline void __WFI(void) { }
+
+#endif /* STM32G4XX_H */
@@ -0,0 +1,104 @@
+#ifndef STM32G4XX_HAL_H
+#define STM32G4XX_HAL_H
+
+/*
+ * Host stand-in for the STM32G4 HAL used by the radio driver. SPI and GPIO
+ * calls are routed by hal_shim.c to the attached SX1272 models, HAL_Delay()
+ * and HAL_GetTick() run on its virtual clock.
+ */
+
+#include "stm32g4xx.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#define __weak  __attribute__((weak))
+
+typedef enum {
+    HAL_OK      = 0x00U,
+    HAL_ERROR   = 0x01U,
+    HAL_BUSY    = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+#define HAL_MAX_DELAY  0xFFFFFFFFU
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct {
+    uint32_t ODR;
+    void    *shim_nss[16];       // Models selected and reset per pin, see hal_shim.c
+    void    *shim_reset[16];
+} GPIO_TypeDef;
+
+extern GPIO_TypeDef hal_shim_gpio[3];
+#define GPIOA  (&hal_shim_gpio[0])
+#define GPIOB  (&hal_shim_gpio[1])
+#define GPIOC  (&hal_shim_gpio[2])
+
+#define GPIO_PIN_0   ((uint16_t)0x0001)
+#define GPIO_PIN_1   ((uint16_t)0x0002)
+#define GPIO_PIN_2   ((uint16_t)0x0004)
+#define GPIO_PIN_3   ((uint16_t)0x0008)
+#define GPIO_PIN_4   ((uint16_t)0x0010)
+#define GPIO_PIN_5   ((uint16_t)0x0020)
+#define GPIO_PIN_6   ((uint16_t)0x0040)
+#define GPIO_PIN_7   ((uint16_t)0x0080)
+#define GPIO_PIN_8   ((uint16_t)0x0100)
+#define GPIO_PIN_9   ((uint16_t)0x0200)
+#define GPIO_PIN_10  ((uint16_t)0x0400)
+#define GPIO_PIN_11  ((uint16_t)0x0800)
+#define GPIO_PIN_12  ((uint16_t)0x1000)
+#define GPIO_PIN_13  ((uint16_t)0x2000)
+#define GPIO_PIN_14  ((uint16_t)0x4000)
+#define GPIO_PIN_15  ((uint16_t)0x8000)
+
+// fPCLK divided by 2^(n+1), as in the SPI_CR1 BR field
+#define SPI_BAUDRATEPRESCALER_2    0x00000000U
+#define SPI_BAUDRATEPRESCALER_4    0x00000008U
+#define SPI_BAUDRATEPRESCALER_8    0x00000010U
+#define SPI_BAUDRATEPRESCALER_16   0x00000018U
+#define SPI_BAUDRATEPRESCALER_32   0x00000020U
+#define SPI_BAUDRATEPRESCALER_64   0x00000028U
+#define SPI_BAUDRATEPRESCALER_128  0x00000030U
+#define SPI_BAUDRATEPRESCALER_256  0x00000038U
+
+typedef struct {
+    uint32_t dummy;
+} SPI_TypeDef;
+
+typedef struct {
+    uint32_t BaudRatePrescaler;
+} SPI_InitTypeDef;
+
+typedef struct __SPI_HandleTypeDef {
+    SPI_TypeDef     *Instance;
+    SPI_InitTypeDef  Init;
+    void            *shim_selected;  // Model whose NSS is low on this bus
+} SPI_HandleTypeDef;
+
+typedef int32_t IRQn_Type;
+#define PendSV_IRQn  ((IRQn_Type)-2)
+
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t delay);
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+void HAL_NVIC_SetPriority(IRQn_Type irqn, uint32_t preempt, uint32_t sub);
+void HAL_NVIC_EnableIRQ(IRQn_Type irqn);
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state);
+void HAL_GPIO_EXTI_Callback(uint16_t pin);
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *hspi, uint8_t *data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *hspi, uint8_t *tx, uint8_t *rx, uint16_t size, uint32_t timeout);
+// DMA transfers complete before returning; the completion callback runs inside
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef *hspi, uint8_t *data, uint16_t size);
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi);
+
+#endif /* STM32G4XX_HAL_H */
@@ -0,0 +1,122 @@
+#ifndef SX1272_MODEL_H
+#define SX1272_MODEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Register-level SX1272 model in LoRa mode.
+ *
+ * Covers the register map with its reset values, the 256-byte FIFO behind
+ * REG_FIFO and REG_FIFO_ADDR_PTR, burst auto-increment, OP_MODE transitions
+ * (TX, RX continuous, CAD, standby, sleep), write-1-to-clear IRQ flags with
+ * REG_IRQ_FLAGS_MASK and DIO0 mapping. TX, RX and CAD complete after the
+ * airtime the modem registers imply, or after a fixed configured time.
+ *
+ * Time is in nanoseconds of the caller's virtual clock. The model has no
+ * notion of the air itself: a received packet is handed in with
+ * sx1272_model_deliver(), a sent one is handed out through on_tx.
+ */
+
+#define SX1272_MODEL_VERSION  0x22
+
+typedef enum {
+    SX1272_MODEL_IDLE,
+    SX1272_MODEL_TX,
+    SX1272_MODEL_RX,
+    SX1272_MODEL_CAD
+} sx1272_model_op_t;
+
+typedef struct {
+    uint32_t spi_transactions;  // NSS low to high
+    uint32_t spi_bytes;
+    uint32_t tx_frames;
+    uint32_t rx_frames;
+    uint32_t rx_missed;         // Delivered while not listening
+    uint32_t rx_collisions;     // Overlapped another reception, both lost
+    uint32_t cad_runs;
+} sx1272_model_stats_t;
+
+typedef struct sx1272_model sx1272_model_t;
+
+struct sx1272_model {
+    uint8_t  regs[0x80];
+    uint8_t  fifo[256];
+
+    // SPI transaction in progress
+    bool     selected;
+    bool     addressed;
+    bool     writing;
+    uint8_t  addr;
+
+    uint64_t now;               // Set by the bus before each transaction
+
+    // Operation in progress and when it completes
+    sx1272_model_op_t op;
+    uint64_t done_at;
+    bool     rx_busy;           // A packet is on its way in
+    bool     rx_corrupt;
+    uint8_t  rx_data[256];
+    uint8_t  rx_ptr;            // Where the next packet is stored, wraps at 256
+    uint8_t  rx_length;
+    int16_t  rx_rssi;
+    int8_t   rx_snr;
+
+    bool     dio0;
+    bool     carrier;           // Another transmitter is on the channel (CAD)
+    uint32_t fixed_airtime_us;  // 0: from the modem registers
+    uint32_t noise;
+
+    // Called when TX starts and when it ends, with the frame as sent
+    void   (*on_tx_start)(sx1272_model_t *model, uint8_t length);
+    void   (*on_tx)(sx1272_model_t *model, const uint8_t *data, uint8_t length);
+    // Called on a rising DIO0 edge
+    void   (*on_dio0)(sx1272_model_t *model);
+    void    *user;
+    void    *bus;               // Owned by the bus the model is attached to
+
+    sx1272_model_stats_t stats;
+};
+
+/**
+ * @brief Power-on reset: registers to their reset values, FIFO cleared.
+ *
+ * Callbacks, user pointer, fixed airtime and statistics are kept.
+ */
+void sx1272_model_reset(sx1272_model_t *model);
+
+/**
+ * @brief SPI: NSS low, one byte in each direction, NSS high.
+ */
+void sx1272_model_select(sx1272_model_t *model);
+uint8_t sx1272_model_transfer(sx1272_model_t *model, uint8_t in);
+void sx1272_model_deselect(sx1272_model_t *model);
+
+/**
+ * @brief Time on air of a packet with the current modem registers.
+ */
+uint32_t sx1272_model_airtime_us(const sx1272_model_t *model, uint8_t length);
+
+/**
+ * @brief Receives a packet; RxDone follows its airtime after start.
+ *
+ * A start in the past hands over a packet whose fate the caller has
+ * already decided, RxDone is then due at once.
+ *
+ * @param start  Time the packet began on air (ns).
+ * @return false The radio is not in RX; counted as missed.
+ */
+bool sx1272_model_deliver(sx1272_model_t *model, const uint8_t *data, uint8_t length,
+                          int16_t rssi, int8_t snr, uint64_t start);
+
+/**
+ * @brief Completion time of the operation in progress, UINT64_MAX if none.
+ */
+uint64_t sx1272_model_next_event(const sx1272_model_t *model);
+
+/**
+ * @brief Completes the operation in progress if it is due at now.
+ */
+void sx1272_model_run(sx1272_model_t *model, uint64_t now);
+
+#endif /* SX1272_MODEL_H */
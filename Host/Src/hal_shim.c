@@ -0,0 +1,300 @@
+#include "hal_shim.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    sx1272_model_t    *model;
+    SPI_HandleTypeDef *spi;
+    uint16_t           dio0_pin;
+    uint64_t           queued;     // Event time last pushed to the heap
+} hal_shim_slot_t;
+
+typedef struct {
+    uint64_t           at;
+    uint64_t           seq;        // Keeps equal times in FIFO order
+    hal_shim_slot_t   *slot;       // Model event, or
+    hal_shim_timer_fn  fn;         // timer
+    void              *arg;
+} hal_shim_event_t;
+
+DWT_Type hal_shim_dwt;
+CoreDebug_Type hal_shim_core_debug;
+SCB_Type hal_shim_scb;
+GPIO_TypeDef hal_shim_gpio[3];
+uint32_t SystemCoreClock = HAL_SHIM_HCLK_HZ;
+uint32_t hal_shim_primask;
+uint32_t hal_shim_basepri;
+
+static hal_shim_event_t *heap;
+static size_t heapSize;
+static size_t heapCapacity;
+static uint64_t heapSeq;
+
+static uint64_t nowNs;
+static bool running;               // An event is being run
+static hal_shim_slot_t *current;
+static hal_shim_stats_t stats;
+
+// CYCCNT counts on from whatever the firmware wrote to it
+static void hal_shim_set_time(uint64_t ns) {
+    uint64_t before = nowNs * (HAL_SHIM_HCLK_HZ / 1000000U) / 1000U;
+    uint64_t after = ns * (HAL_SHIM_HCLK_HZ / 1000000U) / 1000U;
+
+    hal_shim_dwt.CYCCNT += (uint32_t)(after - before);
+    nowNs = ns;
+}
+
+static bool hal_shim_before(const hal_shim_event_t *a, const hal_shim_event_t *b) {
+    return a->at < b->at || (a->at == b->at && a->seq < b->seq);
+}
+
+static void hal_shim_push(hal_shim_event_t event) {
+    size_t i;
+
+    if (heapSize == heapCapacity) {
+        heapCapacity = heapCapacity ? 2 * heapCapacity : 64;
+        heap = realloc(heap, heapCapacity * sizeof(*heap));
+        if (heap == NULL) abort();
+    }
+
+    event.seq = heapSeq++;
+    for (i = heapSize++; i > 0; i = (i - 1) / 2) {
+        if (!hal_shim_before(&event, &heap[(i - 1) / 2])) break;
+        heap[i] = heap[(i - 1) / 2];
+    }
+    heap[i] = event;
+}
+
+static hal_shim_event_t hal_shim_pop(void) {
+    hal_shim_event_t top = heap[0];
+    hal_shim_event_t last = heap[--heapSize];
+    size_t i = 0;
+
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= heapSize) break;
+        if (child + 1 < heapSize && hal_shim_before(&heap[child + 1], &heap[child])) child++;
+        if (!hal_shim_before(&heap[child], &last)) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (heapSize > 0) heap[i] = last;
+    return top;
+}
+
+// Stale entries stay in the heap and are skipped when they come up
+static void hal_shim_reschedule(hal_shim_slot_t *slot) {
+    uint64_t at = sx1272_model_next_event(slot->model);
+
+    if (at == UINT64_MAX || at == slot->queued) return;
+    slot->queued = at;
+    hal_shim_push((hal_shim_event_t){ .at = at, .slot = slot });
+}
+
+static void hal_shim_dio0(sx1272_model_t *model) {
+    hal_shim_slot_t *slot = model->bus;
+
+    stats.dio0_edges++;
+    HAL_GPIO_EXTI_Callback(slot->dio0_pin);
+}
+
+void hal_shim_attach(sx1272_model_t *model, SPI_HandleTypeDef *spi,
+                     GPIO_TypeDef *nss_port, uint16_t nss_pin,
+                     GPIO_TypeDef *reset_port, uint16_t reset_pin, uint16_t dio0_pin) {
+    hal_shim_slot_t *slot = calloc(1, sizeof(*slot));
+
+    if (slot == NULL) abort();
+    slot->model = model;
+    slot->spi = spi;
+    slot->dio0_pin = dio0_pin;
+    slot->queued = UINT64_MAX;
+
+    model->bus = slot;
+    model->on_dio0 = hal_shim_dio0;
+    sx1272_model_reset(model);
+
+    nss_port->shim_nss[__builtin_ctz(nss_pin)] = slot;
+    reset_port->shim_reset[__builtin_ctz(reset_pin)] = slot;
+    nss_port->ODR |= nss_pin;
+    reset_port->ODR |= reset_pin;
+}
+
+void hal_shim_schedule(sx1272_model_t *model) {
+    hal_shim_reschedule(model->bus);
+}
+
+void hal_shim_call_at(uint64_t at_ns, hal_shim_timer_fn fn, void *arg) {
+    hal_shim_push((hal_shim_event_t){ .at = at_ns, .fn = fn, .arg = arg });
+}
+
+sx1272_model_t *hal_shim_current(void) {
+    return current != NULL ? current->model : NULL;
+}
+
+uint64_t hal_shim_now_ns(void) {
+    return nowNs;
+}
+
+uint64_t hal_shim_next_ns(void) {
+    while (heapSize > 0) {
+        hal_shim_event_t *top = &heap[0];
+        if (top->slot == NULL || top->at == sx1272_model_next_event(top->slot->model)) return top->at;
+        (void)hal_shim_pop();
+    }
+    return UINT64_MAX;
+}
+
+// Runs every event due by target in time order, then sets the clock to target
+static void hal_shim_run_until(uint64_t target) {
+    // Inside an event only that event's MCU moves on
+    if (running) {
+        if (target > nowNs) hal_shim_set_time(target);
+        return;
+    }
+
+    running = true;
+    while (heapSize > 0 && heap[0].at <= target) {
+        hal_shim_event_t event = hal_shim_pop();
+        uint64_t start;
+
+        if (event.slot != NULL) {
+            // Superseded by a later reschedule
+            if (event.at != sx1272_model_next_event(event.slot->model)) continue;
+            event.slot->queued = UINT64_MAX;
+        }
+        if (event.at > nowNs) hal_shim_set_time(event.at);
+        start = nowNs;
+
+        if (event.slot != NULL) {
+            current = event.slot;
+            sx1272_model_run(event.slot->model, nowNs);
+            current = NULL;
+            hal_shim_reschedule(event.slot);
+        } else {
+            event.fn(event.arg);
+        }
+
+        // The event's own SPI time is not everybody's time
+        hal_shim_set_time(start);
+    }
+    if (target > nowNs) hal_shim_set_time(target);
+    running = false;
+}
+
+void hal_shim_advance_ns(uint64_t ns) {
+    hal_shim_run_until(nowNs + ns);
+}
+
+bool hal_shim_idle(void) {
+    uint64_t due = hal_shim_next_ns();
+
+    if (due == UINT64_MAX) return false;
+    hal_shim_run_until(due > nowNs ? due : nowNs);
+    return true;
+}
+
+const hal_shim_stats_t *hal_shim_get_stats(void) {
+    return &stats;
+}
+
+void hal_shim_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+uint32_t HAL_GetTick(void) {
+    return (uint32_t)(nowNs / 1000000U);
+}
+
+void HAL_Delay(uint32_t delay) {
+    hal_shim_advance_ns((uint64_t)delay * 1000000U);
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void) {
+    return HAL_SHIM_PCLK_HZ;
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type irqn, uint32_t preempt, uint32_t sub) {
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type irqn) {
+}
+
+__weak void HAL_GPIO_EXTI_Callback(uint16_t pin) {
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state) {
+    unsigned index = __builtin_ctz(pin);
+    bool wasHigh = (port->ODR & pin) != 0;
+    hal_shim_slot_t *nss = port->shim_nss[index];
+    hal_shim_slot_t *reset = port->shim_reset[index];
+
+    if (state == GPIO_PIN_SET) port->ODR |= pin;
+    else port->ODR &= ~(uint32_t)pin;
+
+    if (nss != NULL) {
+        if (wasHigh && state == GPIO_PIN_RESET) {
+            sx1272_model_select(nss->model);
+            nss->spi->shim_selected = nss;
+        } else if (!wasHigh && state == GPIO_PIN_SET) {
+            sx1272_model_deselect(nss->model);
+            nss->spi->shim_selected = NULL;
+            stats.spi_transactions++;
+        }
+    }
+    if (reset != NULL && state == GPIO_PIN_RESET) {
+        sx1272_model_reset(reset->model);
+    }
+}
+
+// Clocks size bytes through the selected model; either buffer may be NULL
+static HAL_StatusTypeDef hal_shim_spi(SPI_HandleTypeDef *hspi, const uint8_t *tx, uint8_t *rx, uint16_t size) {
+    hal_shim_slot_t *slot = hspi->shim_selected;
+    uint32_t prescaler = 2U << (hspi->Init.BaudRatePrescaler >> 3);
+    uint64_t busNs = HAL_SHIM_SPI_CALL_NS + (uint64_t)size * 8 * 1000000000U / (HAL_SHIM_PCLK_HZ / prescaler);
+
+    if (slot != NULL) slot->model->now = nowNs;
+    for (uint16_t i = 0; i < size; i++) {
+        uint8_t out = slot != NULL ? sx1272_model_transfer(slot->model, tx != NULL ? tx[i] : 0x00) : 0xFF;
+        if (rx != NULL) rx[i] = out;
+    }
+    if (slot != NULL) hal_shim_reschedule(slot);
+
+    stats.spi_calls++;
+    stats.spi_bytes += size;
+    stats.spi_busy_ns += busNs;
+    hal_shim_advance_ns(busNs);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *data, uint16_t size, uint32_t timeout) {
+    return hal_shim_spi(hspi, data, NULL, size);
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *hspi, uint8_t *data, uint16_t size, uint32_t timeout) {
+    return hal_shim_spi(hspi, NULL, data, size);
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *hspi, uint8_t *tx, uint8_t *rx, uint16_t size, uint32_t timeout) {
+    return hal_shim_spi(hspi, tx, rx, size);
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *data, uint16_t size) {
+    hal_shim_spi(hspi, data, NULL, size);
+    HAL_SPI_TxCpltCallback(hspi);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef *hspi, uint8_t *data, uint16_t size) {
+    hal_shim_spi(hspi, NULL, data, size);
+    HAL_SPI_RxCpltCallback(hspi);
+    return HAL_OK;
+}
+
+__weak void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi) {
+}
+
+__weak void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi) {
+}
+
+__weak void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi) {
+}
@@ -0,0 +1,87 @@
+#include "lora_channel.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// SX1272 sensitivity at 125 kHz, SF7..SF12
+static const int16_t sensitivity[6] = { -124, -127, -130, -133, -135, -137 };
+
+// Minimum SIR in dB of the wanted SF (row) against an interferer SF
+// (column), SF7..SF12; the diagonal is the capture threshold
+static const int8_t sir[6][6] = {
+    {  LORA_CHANNEL_CAPTURE_DB,  -8,  -9,  -9,  -9,  -9 },
+    { -11,  LORA_CHANNEL_CAPTURE_DB, -11, -12, -13, -13 },
+    { -15, -13,  LORA_CHANNEL_CAPTURE_DB, -13, -14, -15 },
+    { -19, -18, -17,  LORA_CHANNEL_CAPTURE_DB, -17, -18 },
+    { -22, -22, -21, -20,  LORA_CHANNEL_CAPTURE_DB, -20 },
+    { -25, -25, -25, -24, -23,  LORA_CHANNEL_CAPTURE_DB },
+};
+
+static uint8_t lora_channel_sf_index(uint8_t sf) {
+    if (sf < 7) return 0;
+    if (sf > 12) return 5;
+    return sf - 7;
+}
+
+double lora_channel_path_loss_db(double distance_m) {
+    if (distance_m < 1.0) distance_m = 1.0;
+    return LORA_CHANNEL_PL_1KM_DB + 10.0 * LORA_CHANNEL_PL_EXPONENT * log10(distance_m / 1000.0);
+}
+
+int16_t lora_channel_sensitivity_dbm(uint8_t sf) {
+    return sensitivity[lora_channel_sf_index(sf)];
+}
+
+int8_t lora_channel_sir_db(uint8_t sf, uint8_t interferer_sf) {
+    return sir[lora_channel_sf_index(sf)][lora_channel_sf_index(interferer_sf)];
+}
+
+void lora_channel_init(lora_channel_t *channel) {
+    memset(channel, 0, sizeof(*channel));
+}
+
+void lora_channel_free(lora_channel_t *channel) {
+    free(channel->tx);
+    memset(channel, 0, sizeof(*channel));
+}
+
+void lora_channel_begin(lora_channel_t *channel, const lora_channel_tx_t *tx) {
+    // Anything that started two airtimes ago has ended before every packet
+    // still on air began, so it can no longer overlap one
+    while (channel->count > 0 && channel->tx[channel->head].start + 2 * channel->longest < tx->start) {
+        channel->head++;
+        channel->count--;
+    }
+
+    if (channel->head + channel->count == channel->capacity) {
+        if (channel->head > 0) {
+            memmove(channel->tx, &channel->tx[channel->head], channel->count * sizeof(*channel->tx));
+            channel->head = 0;
+        }
+        if (channel->count == channel->capacity) {
+            channel->capacity = channel->capacity ? 2 * channel->capacity : 64;
+            channel->tx = realloc(channel->tx, channel->capacity * sizeof(*channel->tx));
+            if (channel->tx == NULL) abort();
+        }
+    }
+
+    channel->tx[channel->head + channel->count++] = *tx;
+    if (tx->end - tx->start > channel->longest) channel->longest = tx->end - tx->start;
+}
+
+lora_channel_outcome_t lora_channel_resolve(const lora_channel_t *channel, uint32_t id) {
+    const lora_channel_tx_t *tx = NULL;
+    const lora_channel_tx_t *end = channel->tx + channel->head + channel->count;
+
+    for (const lora_channel_tx_t *t = channel->tx + channel->head; t < end; t++) {
+        if (t->id == id) tx = t;
+    }
+    if (tx == NULL) return LORA_CHANNEL_COLLIDED;
+    if (tx->rssi < lora_channel_sensitivity_dbm(tx->sf)) return LORA_CHANNEL_WEAK;
+
+    for (const lora_channel_tx_t *t = channel->tx + channel->head; t < end; t++) {
+        if (t == tx || t->end <= tx->start || t->start >= tx->end) continue;
+        if (tx->rssi - t->rssi < lora_channel_sir_db(tx->sf, t->sf)) return LORA_CHANNEL_COLLIDED;
+    }
+    return LORA_CHANNEL_DELIVERED;
+}
@@ -0,0 +1,535 @@
+/*
+ * Discrete-event LoRa network simulator.
+ *
+ * Every node runs the firmware's own sx1272.c and lora_frame.c/aes_gcm.c
+ * against its own SX1272 model, with a frame counter of its own as each
+ * node keeps in flash. Uplinks meet on a lora_channel_t per channel and
+ * reach a gateway with one receiving SX1272 per channel and spreading
+ * factor, where the driver's RX path, the nonce.c replay window and the
+ * AES-GCM open run as they would on a real concentrator.
+ *
+ * The nonce holds the source byte but not the key hint, so the nodes that
+ * share a source byte each get their own key, one per key hint.
+ *
+ * Channels never interfere, so each worker process simulates the nodes of
+ * its own channels; -j spreads the channels across cores. Node placement,
+ * SF choice and traffic come from per-node seeds, so results do not depend
+ * on the number of workers.
+ *
+ *   lora_sim [-n 10,100,1000,10000] [-t seconds] [-p period_s] [-l payload]
+ *            [-c channels] [-r radius_m] [-j jobs] [-s seed]
+ */
+
+#define _GNU_SOURCE
+#include "sx1272.h"
+#include "hal_shim.h"
+#include "lora_channel.h"
+#include "lora_frame.h"
+#include "nonce.h"
+#include "channel_plan.h"
+#include "cycle_counter.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define SIM_NET_ID        0x42
+#define SIM_MAX_NODES     32768      // Node ID = 7-bit key hint : 8-bit source
+#define SIM_BACKLOG       4          // Frames a node holds while its radio is busy
+#define SIM_MARGIN_DB     3          // Link margin the SF choice keeps
+#define SIM_GATEWAY_ADDR  0x00
+#define SIM_PAYLOAD_MIN   10         // Node ID and generation time
+#define SIM_KEY_GROUPS    (SIM_MAX_NODES >> 8)
+
+typedef struct {
+    uint32_t nodes;
+    uint32_t duration_s;
+    uint32_t period_s;
+    uint8_t  payload;
+    uint8_t  channels;
+    uint32_t radius_m;
+    uint32_t jobs;
+    uint32_t seed;
+} sim_config_t;
+
+typedef struct {
+    uint64_t offered;            // Frames generated
+    uint64_t sent;               // Frames put on air
+    uint64_t backlog_drops;
+    uint64_t delivered;
+    uint64_t weak;
+    uint64_t collided;
+    uint64_t rejected;           // Replay or authentication failures
+    uint64_t bytes;              // Delivered application payload
+    uint64_t latency_ns;
+    uint64_t latency_max_ns;
+    uint64_t node_cpu_ns;        // Host CPU in node firmware
+    uint64_t node_mcu_ns;        // Virtual MCU time of the nodes
+    uint64_t gateway_cpu_ns;
+    uint64_t sf_nodes[6];
+    uint64_t events;
+} sim_result_t;
+
+typedef struct sim_radio sim_radio_t;
+
+struct sim_radio {
+    sx1272_t          radio;     // First: the driver callbacks get this pointer
+    sx1272_model_t    model;
+    SPI_HandleTypeDef spi;
+    GPIO_TypeDef      gpio;
+    bool              gateway;
+
+    // Node
+    uint32_t          id;
+    uint8_t           channel;
+    uint8_t           sf;
+    float             rssi;
+    uint64_t          rng;
+    uint32_t          counter;   // Frame counter, never repeats under the node's key
+    bool              busy;
+    uint8_t           backlog;
+    uint64_t          generated[SIM_BACKLOG + 1];
+    uint64_t          txStart;
+};
+
+static const sim_config_t *config;
+static sim_result_t result;
+static lora_channel_t channels[CHANNEL_COUNT];
+static sim_radio_t *gateways[CHANNEL_COUNT][6];
+static nonce_window_t windows[SIM_MAX_NODES];
+static aes_gcm_ctx_t groupKeys[SIM_KEY_GROUPS];   // Indexed by key hint
+static uint64_t endNs;
+
+static const uint8_t sim_key[AES_KEY_SIZE] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+static uint64_t sim_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000U + ts.tv_nsec;
+}
+
+static uint64_t sim_rand(uint64_t *state) {
+    // xorshift64*
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+static double sim_uniform(uint64_t *state) {
+    return (sim_rand(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static uint64_t sim_exponential_ns(uint64_t *state, uint32_t mean_s) {
+    return (uint64_t)(-log(1.0 - sim_uniform(state)) * mean_s * 1e9);
+}
+
+static uint8_t sim_channel_of(uint32_t id) {
+    return id % config->channels;
+}
+
+static void sim_attach(sim_radio_t *r) {
+    r->spi.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_32;
+    r->radio.spi = &r->spi;
+    r->radio.nssPort = &r->gpio;
+    r->radio.nssPin = GPIO_PIN_4;
+    r->radio.resetPort = &r->gpio;
+    r->radio.resetPin = GPIO_PIN_3;
+    r->radio.dio0Pin = GPIO_PIN_0;
+    r->model.user = r;
+    hal_shim_attach(&r->model, &r->spi, &r->gpio, GPIO_PIN_4, &r->gpio, GPIO_PIN_3, GPIO_PIN_0);
+}
+
+static void sim_tune(sim_radio_t *r, uint8_t sf) {
+    SX1272_ModemParams_t params = { sf, SX1272_CR_4_5, LORA_CHANNEL_TX_POWER_DBM };
+
+    SX1272_Init(&r->radio);
+    SX1272_SetModemParams(&r->radio, &params);
+    SX1272_SetFrf(&r->radio, channel_plan_frf(r->channel), channel_plan_freq(r->channel));
+}
+
+// Seals the oldest backlog frame and keys the radio
+static void sim_transmit(sim_radio_t *node) {
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+    uint8_t frame[FRAME_MAX_SIZE];
+    uint64_t generated = node->generated[0];
+    uint8_t length;
+
+    memset(payload, 0, config->payload);
+    payload[0] = node->id >> 8;
+    payload[1] = node->id & 0xFF;
+    memcpy(&payload[2], &generated, sizeof(generated));
+
+    lora_frame_header_t header = {
+        .net_id   = SIM_NET_ID,
+        .dst      = SIM_GATEWAY_ADDR,
+        .src      = node->id & 0xFF,
+        .type     = FRAME_TYPE_DATA,
+        .key_hint = (node->id >> 8) & 0x7F,
+        .counter  = node->counter++,
+    };
+    length = lora_frame_seal(&groupKeys[header.key_hint], &header, payload, config->payload, frame);
+
+    memmove(&node->generated[0], &node->generated[1], node->backlog * sizeof(node->generated[0]));
+    node->backlog--;
+    node->busy = true;
+    if (SX1272_Transmit(&node->radio, frame, length) != HAL_OK) node->busy = false;
+}
+
+static void sim_node_wake(void *arg) {
+    sim_radio_t *node = arg;
+    uint64_t cpu = sim_cpu_ns(), now = hal_shim_now_ns();
+
+    if (now >= endNs) return;
+    hal_shim_call_at(now + sim_exponential_ns(&node->rng, config->period_s), sim_node_wake, node);
+
+    result.offered++;
+    if (node->backlog >= SIM_BACKLOG) {
+        result.backlog_drops++;
+        return;
+    }
+    node->generated[node->backlog++] = now;
+    if (!node->busy) sim_transmit(node);
+
+    result.node_cpu_ns += sim_cpu_ns() - cpu;
+    result.node_mcu_ns += hal_shim_now_ns() - now;
+}
+
+static void sim_gateway_boot(void *arg) {
+    sim_radio_t *gw = arg;
+
+    sim_tune(gw, gw->sf);
+    SX1272_Receive(&gw->radio);
+}
+
+static void sim_node_boot(void *arg) {
+    sim_radio_t *node = arg;
+    uint64_t cpu = sim_cpu_ns(), now = hal_shim_now_ns();
+
+    sim_tune(node, node->sf);
+    result.node_cpu_ns += sim_cpu_ns() - cpu;
+    result.node_mcu_ns += hal_shim_now_ns() - now;
+}
+
+static void sim_tx_start(sx1272_model_t *model, uint8_t length) {
+    sim_radio_t *node = model->user;
+    lora_channel_tx_t tx = {
+        .start = model->now,
+        .end   = model->now + (uint64_t)sx1272_model_airtime_us(model, length) * 1000,
+        .rssi  = node->rssi,
+        .sf    = node->sf,
+        .id    = node->id,
+    };
+
+    node->txStart = tx.start;
+    lora_channel_begin(&channels[node->channel], &tx);
+    result.sent++;
+}
+
+static void sim_tx_end(sx1272_model_t *model, const uint8_t *data, uint8_t length) {
+    sim_radio_t *node = model->user;
+    sim_radio_t *gw = gateways[node->channel][node->sf - SX1272_SF_MIN];
+    int snr = (int)lroundf(node->rssi) - LORA_CHANNEL_NOISE_DBM;
+
+    switch (lora_channel_resolve(&channels[node->channel], node->id)) {
+    case LORA_CHANNEL_WEAK:
+        result.weak++;
+        return;
+    case LORA_CHANNEL_COLLIDED:
+        result.collided++;
+        return;
+    default:
+        break;
+    }
+
+    if (snr > 31) snr = 31;
+    sx1272_model_deliver(&gw->model, data, length, (int16_t)lroundf(node->rssi), (int8_t)snr, node->txStart);
+    hal_shim_schedule(&gw->model);
+}
+
+// Concentrator: authenticate and account every packet the radio committed
+static void sim_gateway_drain(sim_radio_t *gw) {
+    uint64_t cpu = sim_cpu_ns();
+    rx_packet_t *packet;
+
+    while ((packet = rx_ring_peek(&gw->radio.rxRing)) != NULL) {
+        lora_frame_header_t header;
+        uint8_t payload[FRAME_MAX_PAYLOAD];
+
+        lora_frame_parse_header(packet->data, &header);
+        uint32_t id = ((uint32_t)(header.key_hint & 0x7F) << 8) | header.src;
+
+        if (packet->length >= FRAME_OVERHEAD + SIM_PAYLOAD_MIN &&
+            nonce_window_check(&windows[id], header.counter) &&
+            lora_frame_open(&groupKeys[header.key_hint & 0x7F], &header, packet->data, packet->length, payload)) {
+            uint64_t generated, latency;
+
+            nonce_window_update(&windows[id], header.counter);
+            memcpy(&generated, &payload[2], sizeof(generated));
+            latency = hal_shim_now_ns() - generated;
+
+            result.delivered++;
+            result.bytes += packet->length - FRAME_OVERHEAD;
+            result.latency_ns += latency;
+            if (latency > result.latency_max_ns) result.latency_max_ns = latency;
+        } else {
+            result.rejected++;
+        }
+        rx_ring_release(&gw->radio.rxRing);
+    }
+    result.gateway_cpu_ns += sim_cpu_ns() - cpu;
+}
+
+void HAL_GPIO_EXTI_Callback(uint16_t pin) {
+    sx1272_model_t *model = hal_shim_current();
+    sim_radio_t *r;
+    uint64_t cpu, now;
+
+    if (model == NULL) return;
+    r = model->user;
+    cpu = sim_cpu_ns();
+    now = hal_shim_now_ns();
+
+    SX1272_HandleDIO0(&r->radio, HAL_GetTick(), cycle_counter_read());
+
+    if (r->gateway) {
+        sim_gateway_drain(r);
+    } else {
+        result.node_cpu_ns += sim_cpu_ns() - cpu;
+        result.node_mcu_ns += hal_shim_now_ns() - now;
+    }
+}
+
+bool SX1272_TxDoneCallback(sx1272_t *radio) {
+    sim_radio_t *node = (sim_radio_t *)radio;
+
+    node->busy = false;
+    if (node->backlog == 0) return false;
+
+    sim_transmit(node);
+    return node->busy;
+}
+
+// Nodes of the given worker, on channels worker, worker + jobs, ...
+static void sim_run_worker(uint32_t worker, sim_result_t *out) {
+    uint32_t count = 0;
+    sim_radio_t *nodes;
+
+    memset(&result, 0, sizeof(result));
+    for (uint32_t g = 0; g < SIM_KEY_GROUPS; g++) {
+        uint8_t key[AES_KEY_SIZE];
+
+        memcpy(key, sim_key, sizeof(key));
+        key[0] ^= g;
+        aes_gcm_setkey(&groupKeys[g], key);
+    }
+    cycle_counter_init();
+    endNs = (uint64_t)config->duration_s * 1000000000U;
+
+    for (uint32_t id = 0; id < config->nodes; id++) {
+        if (sim_channel_of(id) % config->jobs == worker) count++;
+    }
+    nodes = calloc(count ? count : 1, sizeof(*nodes));
+    if (nodes == NULL) abort();
+
+    for (uint8_t ch = worker; ch < config->channels; ch += config->jobs) {
+        lora_channel_init(&channels[ch]);
+        for (uint8_t sf = SX1272_SF_MIN; sf <= SX1272_SF_MAX; sf++) {
+            sim_radio_t *gw = calloc(1, sizeof(*gw));
+            if (gw == NULL) abort();
+            gw->gateway = true;
+            gw->channel = ch;
+            gw->sf = sf;
+            sim_attach(gw);
+            hal_shim_call_at(0, sim_gateway_boot, gw);
+            gateways[ch][sf - SX1272_SF_MIN] = gw;
+        }
+    }
+
+    count = 0;
+    for (uint32_t id = 0; id < config->nodes; id++) {
+        sim_radio_t *node;
+        double distance;
+
+        if (sim_channel_of(id) % config->jobs != worker) continue;
+        node = &nodes[count++];
+        node->id = id;
+        node->channel = sim_channel_of(id);
+        node->rng = ((uint64_t)config->seed << 32) ^ (id * 0x9E3779B97F4A7C15ULL) ^ 1;
+
+        // Uniform over the disc around the gateway
+        distance = config->radius_m * sqrt(sim_uniform(&node->rng));
+        node->rssi = LORA_CHANNEL_TX_POWER_DBM - lora_channel_path_loss_db(distance);
+        node->sf = SX1272_SF_MAX;
+        for (uint8_t sf = SX1272_SF_MIN; sf < SX1272_SF_MAX; sf++) {
+            if (node->rssi >= lora_channel_sensitivity_dbm(sf) + SIM_MARGIN_DB) {
+                node->sf = sf;
+                break;
+            }
+        }
+        result.sf_nodes[node->sf - SX1272_SF_MIN]++;
+
+        sim_attach(node);
+        node->model.on_tx_start = sim_tx_start;
+        node->model.on_tx = sim_tx_end;
+        hal_shim_call_at(0, sim_node_boot, node);
+        hal_shim_call_at(sim_exponential_ns(&node->rng, config->period_s), sim_node_wake, node);
+    }
+
+    // Let the last frames land
+    while (hal_shim_next_ns() != UINT64_MAX) {
+        hal_shim_idle();
+        result.events++;
+    }
+
+    *out = result;
+}
+
+static void sim_add(sim_result_t *total, const sim_result_t *r) {
+    const uint64_t *src = (const uint64_t *)r;
+    uint64_t *dst = (uint64_t *)total;
+
+    for (size_t i = 0; i < sizeof(*r) / sizeof(uint64_t); i++) {
+        if (&dst[i] == &total->latency_max_ns) {
+            if (src[i] > dst[i]) dst[i] = src[i];
+        } else {
+            dst[i] += src[i];
+        }
+    }
+}
+
+static int sim_run(const sim_config_t *cfg, sim_result_t *total) {
+    pid_t pids[CHANNEL_COUNT];
+    int pipes[CHANNEL_COUNT];
+    int failed = 0;
+
+    config = cfg;
+    memset(total, 0, sizeof(*total));
+
+    for (uint32_t w = 0; w < cfg->jobs; w++) {
+        int fd[2];
+
+        if (pipe(fd) != 0) return -1;
+        pids[w] = fork();
+        if (pids[w] < 0) return -1;
+        if (pids[w] == 0) {
+            sim_result_t r;
+
+            close(fd[0]);
+            sim_run_worker(w, &r);
+            if (write(fd[1], &r, sizeof(r)) != (ssize_t)sizeof(r)) _exit(1);
+            _exit(0);
+        }
+        close(fd[1]);
+        pipes[w] = fd[0];
+    }
+
+    for (uint32_t w = 0; w < cfg->jobs; w++) {
+        sim_result_t r;
+        int status;
+
+        if (read(pipes[w], &r, sizeof(r)) == (ssize_t)sizeof(r)) sim_add(total, &r);
+        else failed = 1;
+        close(pipes[w]);
+        waitpid(pids[w], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = 1;
+    }
+    return failed ? -1 : 0;
+}
+
+static double sim_wall_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void sim_usage(const char *name) {
+    fprintf(stderr, "usage: %s [-n nodes[,nodes...]] [-t seconds] [-p period_s] [-l payload]\n"
+                    "       [-c channels] [-r radius_m] [-j jobs] [-s seed]\n", name);
+}
+
+int main(int argc, char **argv) {
+    sim_config_t cfg = {
+        .duration_s = 3600,
+        .period_s   = 600,
+        .payload    = 20,
+        .channels   = CHANNEL_COUNT,
+        .radius_m   = 3000,
+        .jobs       = 0,
+        .seed       = 1,
+    };
+    const char *counts = "10,100,1000,10000";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:t:p:l:c:r:j:s:h")) != -1) {
+        switch (opt) {
+        case 'n': counts = optarg; break;
+        case 't': cfg.duration_s = strtoul(optarg, NULL, 0); break;
+        case 'p': cfg.period_s = strtoul(optarg, NULL, 0); break;
+        case 'l': cfg.payload = strtoul(optarg, NULL, 0); break;
+        case 'c': cfg.channels = strtoul(optarg, NULL, 0); break;
+        case 'r': cfg.radius_m = strtoul(optarg, NULL, 0); break;
+        case 'j': cfg.jobs = strtoul(optarg, NULL, 0); break;
+        case 's': cfg.seed = strtoul(optarg, NULL, 0); break;
+        default:
+            sim_usage(argv[0]);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (cfg.channels < 1 || cfg.channels > CHANNEL_COUNT || cfg.period_s == 0 ||
+        cfg.payload < SIM_PAYLOAD_MIN || cfg.payload > FRAME_MAX_PAYLOAD) {
+        sim_usage(argv[0]);
+        return 2;
+    }
+    if (cfg.jobs == 0) cfg.jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cfg.jobs > cfg.channels) cfg.jobs = cfg.channels;
+    if (cfg.jobs < 1) cfg.jobs = 1;
+
+    printf("%u s, one frame per %u s per node, %u B payload, %u channels, %u m radius, %u workers\n",
+           cfg.duration_s, cfg.period_s, cfg.payload, cfg.channels, cfg.radius_m, cfg.jobs);
+    printf("%6s %8s %8s %6s %6s %6s %9s %9s %9s %8s %8s %7s\n",
+           "nodes", "offered", "deliv", "PDR%", "coll%", "weak%", "bit/s", "lat_ms", "max_ms",
+           "cpu_us", "mcu_us", "speedup");
+
+    for (const char *p = counts; *p != '\0'; ) {
+        char *next;
+        sim_result_t total;
+        double wall;
+
+        cfg.nodes = strtoul(p, &next, 0);
+        if (cfg.nodes == 0 || cfg.nodes > SIM_MAX_NODES) {
+            sim_usage(argv[0]);
+            return 2;
+        }
+
+        wall = sim_wall_s();
+        if (sim_run(&cfg, &total) != 0) {
+            fprintf(stderr, "worker failed\n");
+            return 1;
+        }
+        wall = sim_wall_s() - wall;
+
+        double offered = total.offered ? (double)total.offered : 1.0;
+        double delivered = total.delivered ? (double)total.delivered : 1.0;
+        printf("%6u %8llu %8llu %6.1f %6.1f %6.1f %9.1f %9.1f %9.1f %8.1f %8.1f %6.0fx\n",
+               cfg.nodes, (unsigned long long)total.offered, (unsigned long long)total.delivered,
+               100.0 * total.delivered / offered, 100.0 * total.collided / offered, 100.0 * total.weak / offered,
+               total.bytes * 8.0 / cfg.duration_s,
+               total.latency_ns / delivered / 1e6, total.latency_max_ns / 1e6,
+               total.node_cpu_ns / 1e3 / cfg.nodes, total.node_mcu_ns / 1e3 / cfg.nodes,
+               cfg.duration_s / wall);
+        if (total.rejected != 0 || total.backlog_drops != 0) {
+            printf("%6s %llu frames failed replay or authentication checks, %llu dropped from a full backlog\n", "",
+                   (unsigned long long)total.rejected, (unsigned long long)total.backlog_drops);
+        }
+
+        p = (*next == ',') ? next + 1 : next;
+    }
+    return 0;
+}
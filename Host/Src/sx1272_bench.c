@@ -0,0 +1,195 @@
+/*
+ * Host benchmark of the SX1272 driver against the register-level model.
+ *
+ * All figures are in virtual time (see hal_shim.h), so they are the same
+ * on every host and change only when the driver or the model does. Every
+ * frame is checked end to end; the exit status is non-zero on a mismatch.
+ */
+
+#include "sx1272.h"
+#include "hal_shim.h"
+#include "cycle_counter.h"
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_FRAMES      100
+#define BENCH_REG_ROUNDS  1000
+
+static SPI_HandleTypeDef hspi1 = { .Init = { .BaudRatePrescaler = SPI_BAUDRATEPRESCALER_32 } };
+static sx1272_t radio = {
+    .spi       = &hspi1,
+    .nssPort   = GPIOA,
+    .nssPin    = GPIO_PIN_4,
+    .resetPort = GPIOA,
+    .resetPin  = GPIO_PIN_3,
+    .dio0Pin   = GPIO_PIN_0,
+};
+static sx1272_model_t model;
+
+static volatile bool dio0;
+static uint32_t dio0Cycles;
+static uint64_t dio0Ns;
+
+static uint8_t sent[256];
+static uint8_t sentLength;
+static int failures;
+
+void HAL_GPIO_EXTI_Callback(uint16_t pin) {
+    if (pin == radio.dio0Pin) {
+        dio0Cycles = cycle_counter_read();
+        dio0Ns = hal_shim_now_ns();
+        dio0 = true;
+    }
+}
+
+static void bench_on_tx(sx1272_model_t *m, const uint8_t *data, uint8_t length) {
+    memcpy(sent, data, length);
+    sentLength = length;
+}
+
+static void bench_check(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// Waits for DIO0 like WFI would, then services it
+static bool bench_service(void) {
+    while (!dio0) {
+        if (!hal_shim_idle()) return false;
+    }
+    dio0 = false;
+    return SX1272_HandleDIO0(&radio, HAL_GetTick(), dio0Cycles);
+}
+
+static void bench_fill(uint8_t *frame, uint8_t length, uint32_t seed) {
+    for (uint8_t i = 0; i < length; i++) frame[i] = (uint8_t)(seed * 31 + i * 7);
+}
+
+static void bench_registers(void) {
+    SX1272_RegBench_t result;
+    const hal_shim_stats_t *stats = hal_shim_get_stats();
+
+    hal_shim_reset_stats();
+    SX1272_BenchmarkRegAccess(&radio, BENCH_REG_ROUNDS, &result);
+
+    printf("registers:  %7lu reads/s  %7lu writes/s  %.2f SPI transactions per access\n",
+           (unsigned long)result.reads_per_sec, (unsigned long)result.writes_per_sec,
+           (double)stats->spi_transactions / (2 * BENCH_REG_ROUNDS));
+}
+
+static void bench_tx(uint8_t length) {
+    const hal_shim_stats_t *stats = hal_shim_get_stats();
+    uint8_t frame[256];
+    uint64_t start, airtime = 0;
+
+    SX1272_Receive(&radio);
+    hal_shim_reset_stats();
+    start = hal_shim_now_ns();
+
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+        bench_fill(frame, length, i);
+        sentLength = 0;
+        bench_check(SX1272_Transmit(&radio, frame, length) == HAL_OK, "transmit accepted");
+        bench_check(bench_service(), "TxDone serviced");
+        bench_check(sentLength == length && memcmp(sent, frame, length) == 0, "frame on air matches");
+        airtime += SX1272_TimeOnAir(&radio, length, false);
+    }
+
+    uint64_t elapsed = hal_shim_now_ns() - start;
+    printf("tx %3u B:   %7.1f frames/s  airtime %5.1f%%  %5.1f SPI transactions  %6.1f us bus per frame\n",
+           length, BENCH_FRAMES * 1e9 / elapsed, 100.0 * airtime * 1000 / elapsed,
+           (double)stats->spi_transactions / BENCH_FRAMES,
+           stats->spi_busy_ns / 1000.0 / BENCH_FRAMES);
+}
+
+static void bench_rx(uint8_t length) {
+    const hal_shim_stats_t *stats = hal_shim_get_stats();
+    uint8_t frame[256];
+    uint64_t latency = 0, worst = 0;
+
+    SX1272_Receive(&radio);
+    hal_shim_reset_stats();
+
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+        rx_packet_t *packet;
+
+        bench_fill(frame, length, i + 1000);
+        bench_check(sx1272_model_deliver(&model, frame, length, -90, 7, hal_shim_now_ns()), "radio listening");
+        hal_shim_schedule(&model);
+        bench_check(bench_service(), "RxDone serviced");
+
+        // DIO0 edge to packet committed in the ring
+        uint64_t took = hal_shim_now_ns() - dio0Ns;
+        latency += took;
+        if (took > worst) worst = took;
+
+        packet = rx_ring_peek(&radio.rxRing);
+        bench_check(packet != NULL, "packet committed");
+        if (packet != NULL) {
+            bench_check(packet->length == length && memcmp(packet->data, frame, length) == 0, "payload matches");
+            bench_check(packet->rssi == -90 && packet->snr == 7, "link metadata");
+            rx_ring_release(&radio.rxRing);
+        }
+    }
+
+    printf("rx %3u B:   %7.1f us mean  %7.1f us worst DIO0 to ring  %5.1f SPI transactions per packet\n",
+           length, latency / 1000.0 / BENCH_FRAMES, worst / 1000.0,
+           (double)stats->spi_transactions / BENCH_FRAMES);
+}
+
+// Split FIFO: a preloaded frame must survive packets received before TX starts
+static void bench_preload(uint8_t length) {
+    uint8_t frame[256], packet[64];
+
+    SX1272_Receive(&radio);
+    bench_fill(frame, length, 77);
+    bench_check(SX1272_PreloadTx(&radio, frame, length) == HAL_OK, "preload accepted");
+
+    for (uint32_t i = 0; i < 8; i++) {
+        bench_fill(packet, sizeof(packet), i + 2000);
+        bench_check(sx1272_model_deliver(&model, packet, sizeof(packet), -90, 7, hal_shim_now_ns()), "radio listening");
+        hal_shim_schedule(&model);
+        bench_check(bench_service(), "RxDone serviced");
+        rx_packet_t *rx = rx_ring_peek(&radio.rxRing);
+        bench_check(rx != NULL && rx->length == sizeof(packet) && memcmp(rx->data, packet, sizeof(packet)) == 0,
+                    "payload matches");
+        if (rx != NULL) rx_ring_release(&radio.rxRing);
+    }
+
+    sentLength = 0;
+    bench_check(SX1272_StartTx(&radio) == HAL_OK, "preloaded TX started");
+    bench_check(bench_service(), "TxDone serviced");
+    bench_check(sentLength == length && memcmp(sent, frame, length) == 0, "preloaded frame intact");
+}
+
+int main(void) {
+    model.on_tx = bench_on_tx;
+    hal_shim_attach(&model, &hspi1, radio.nssPort, radio.nssPin, radio.resetPort, radio.resetPin, radio.dio0Pin);
+    cycle_counter_init();
+
+    SX1272_Init(&radio);
+    bench_check(SX1272_ReadReg(&radio, REG_VERSION) == SX1272_MODEL_VERSION, "version register");
+
+    bench_registers();
+    for (int split = 0; split <= 1; split++) {
+        SX1272_SetFifoSplit(&radio, split);
+        printf("-- %s FIFO\n", split ? "split" : "shared");
+        bench_tx(16);
+        bench_tx(64);
+        bench_tx(split ? SX1272_FIFO_SPLIT_SIZE : 255);
+        bench_rx(16);
+        bench_rx(64);
+        if (split) bench_preload(SX1272_FIFO_SPLIT_SIZE);
+    }
+
+    const SX1272_ShadowStats_t *shadow = SX1272_GetShadowStats(&radio);
+    printf("shadow:     %lu writes  %lu skipped\n", (unsigned long)shadow->writes, (unsigned long)shadow->skipped);
+
+    if (failures != 0) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,283 @@
+#include "sx1272_model.h"
+#include "sx1272.h"
+#include "airtime.h"
+#include <string.h>
+
+#define REG_PREAMBLE_MSB     0x20
+#define REG_PREAMBLE_LSB     0x21
+
+#define IRQ_VALID_HEADER_MASK  0x10
+
+#define MODE_MASK            0x07
+#define MODE_RX_SINGLE       0x06
+
+// DIO_MAPPING1 bits 7-6 select the DIO0 source
+static const uint8_t dio0Source[4] = {
+    IRQ_RX_DONE_MASK, IRQ_TX_DONE_MASK, IRQ_CAD_DONE_MASK, 0
+};
+
+static void sx1272_model_update_dio0(sx1272_model_t *model) {
+    uint8_t source = dio0Source[model->regs[REG_DIO_MAPPING1] >> 6];
+    bool level = (model->regs[REG_IRQ_FLAGS] & source) != 0;
+    bool rising = level && !model->dio0;
+
+    model->dio0 = level;
+    if (rising && model->on_dio0 != NULL) model->on_dio0(model);
+}
+
+static void sx1272_model_raise(sx1272_model_t *model, uint8_t flags) {
+    model->regs[REG_IRQ_FLAGS] |= flags & ~model->regs[REG_IRQ_FLAGS_MASK];
+    sx1272_model_update_dio0(model);
+}
+
+static void sx1272_model_standby(sx1272_model_t *model) {
+    model->regs[REG_OP_MODE] = (model->regs[REG_OP_MODE] & ~MODE_MASK) | SX1272_MODE_STDBY;
+    model->op = SX1272_MODEL_IDLE;
+}
+
+void sx1272_model_reset(sx1272_model_t *model) {
+    memset(model->regs, 0, sizeof(model->regs));
+    memset(model->fifo, 0, sizeof(model->fifo));
+
+    model->regs[REG_OP_MODE] = SX1272_MODE_STDBY;
+    model->regs[REG_FRF_MSB] = 0xE4;                 // 915 MHz
+    model->regs[REG_FRF_MID] = 0xC0;
+    model->regs[REG_FRF_LSB] = 0x26;
+    model->regs[REG_PA_CONFIG] = 0x0F;
+    model->regs[REG_FIFO_TX_BASE_ADDR] = 0x80;
+    model->regs[REG_MODEM_CONFIG1] = 0x08;           // 125 kHz, CR 4/5, explicit header
+    model->regs[REG_MODEM_CONFIG2] = 0x70;           // SF7
+    model->regs[REG_PREAMBLE_LSB] = SX1272_PREAMBLE_LENGTH;
+    model->regs[REG_PAYLOAD_LENGTH] = 0x01;
+    model->regs[REG_MAX_PAYLOAD_LENGTH] = 0xFF;
+    model->regs[REG_VERSION] = SX1272_MODEL_VERSION;
+
+    model->selected = false;
+    model->addressed = false;
+    model->op = SX1272_MODEL_IDLE;
+    model->rx_busy = false;
+    model->dio0 = false;
+    if (model->noise == 0) model->noise = 0x2545F491;
+}
+
+uint32_t sx1272_model_airtime_us(const sx1272_model_t *model, uint8_t length) {
+    uint8_t mc1 = model->regs[REG_MODEM_CONFIG1];
+    airtime_params_t params = {
+        .sf              = model->regs[REG_MODEM_CONFIG2] >> 4,
+        .bw_hz           = 125000U << (mc1 >> 6),
+        .cr              = (mc1 >> 3) & 0x07,
+        .preamble        = ((uint16_t)model->regs[REG_PREAMBLE_MSB] << 8) | model->regs[REG_PREAMBLE_LSB],
+        .implicit_header = (mc1 & 0x04) != 0,
+        .crc             = (mc1 & 0x02) != 0,
+        .ldro            = (mc1 & 0x01) != 0,
+    };
+
+    if (model->fixed_airtime_us != 0) return model->fixed_airtime_us;
+    return airtime_us(&params, length);
+}
+
+// CAD listens for about two symbols
+static uint32_t sx1272_model_cad_us(const sx1272_model_t *model) {
+    uint8_t sf = model->regs[REG_MODEM_CONFIG2] >> 4;
+    return 2 * ((1000000U << sf) / 125000U);
+}
+
+static void sx1272_model_set_mode(sx1272_model_t *model, uint8_t value) {
+    uint8_t mode = value & MODE_MASK;
+
+    model->regs[REG_OP_MODE] = value;
+    switch (mode) {
+    case SX1272_MODE_TX: {
+        uint8_t length = model->regs[REG_PAYLOAD_LENGTH];
+        model->op = SX1272_MODEL_TX;
+        model->done_at = model->now + (uint64_t)sx1272_model_airtime_us(model, length) * 1000;
+        model->rx_busy = false;
+        if (model->on_tx_start != NULL) model->on_tx_start(model, length);
+        break;
+    }
+    case SX1272_MODE_RX_CONT:
+    case MODE_RX_SINGLE:
+        if (model->op != SX1272_MODEL_RX) {
+            // Only entering RX rewinds the write pointer to FifoRxBaseAddr
+            model->op = SX1272_MODEL_RX;
+            model->rx_busy = false;
+            model->rx_ptr = model->regs[REG_FIFO_RX_BASE_ADDR];
+        }
+        break;
+    case SX1272_MODE_CAD:
+        model->op = SX1272_MODEL_CAD;
+        model->done_at = model->now + (uint64_t)sx1272_model_cad_us(model) * 1000;
+        model->stats.cad_runs++;
+        break;
+    default:
+        // Sleep, standby and the FS modes abort whatever was running
+        model->op = SX1272_MODEL_IDLE;
+        model->rx_busy = false;
+        break;
+    }
+}
+
+static void sx1272_model_write(sx1272_model_t *model, uint8_t addr, uint8_t value) {
+    switch (addr) {
+    case REG_FIFO:
+        model->fifo[model->regs[REG_FIFO_ADDR_PTR]++] = value;
+        break;
+    case REG_OP_MODE:
+        sx1272_model_set_mode(model, value);
+        break;
+    case REG_IRQ_FLAGS:
+        model->regs[REG_IRQ_FLAGS] &= ~value;
+        sx1272_model_update_dio0(model);
+        break;
+    case REG_VERSION:
+    case REG_FIFO_RX_CURRENT:
+    case REG_RX_NB_BYTES:
+    case REG_PKT_SNR_VALUE:
+    case REG_PKT_RSSI_VALUE:
+        break;                                      // Read-only
+    case REG_DIO_MAPPING1:
+        model->regs[addr] = value;
+        sx1272_model_update_dio0(model);
+        break;
+    default:
+        model->regs[addr] = value;
+        break;
+    }
+}
+
+static uint8_t sx1272_model_read(sx1272_model_t *model, uint8_t addr) {
+    if (addr == REG_FIFO) return model->fifo[model->regs[REG_FIFO_ADDR_PTR]++];
+    if (addr == REG_RSSI_WIDEBAND) {
+        // Receiver noise: only the LSB is meaningful
+        model->noise ^= model->noise << 13;
+        model->noise ^= model->noise >> 17;
+        model->noise ^= model->noise << 5;
+        return 0x40 | (model->noise & 0x01);
+    }
+    return model->regs[addr];
+}
+
+void sx1272_model_select(sx1272_model_t *model) {
+    model->selected = true;
+    model->addressed = false;
+}
+
+uint8_t sx1272_model_transfer(sx1272_model_t *model, uint8_t in) {
+    uint8_t out = 0;
+
+    if (!model->selected) return 0xFF;
+    model->stats.spi_bytes++;
+
+    if (!model->addressed) {
+        model->addressed = true;
+        model->writing = (in & 0x80) != 0;
+        model->addr = in & 0x7F;
+        return 0;
+    }
+
+    if (model->writing) sx1272_model_write(model, model->addr, in);
+    else out = sx1272_model_read(model, model->addr);
+
+    // Bursts auto-increment, except on the FIFO which moves its own pointer
+    if (model->addr != REG_FIFO) model->addr = (model->addr + 1) & 0x7F;
+    return out;
+}
+
+void sx1272_model_deselect(sx1272_model_t *model) {
+    if (model->selected) model->stats.spi_transactions++;
+    model->selected = false;
+}
+
+bool sx1272_model_deliver(sx1272_model_t *model, const uint8_t *data, uint8_t length,
+                          int16_t rssi, int8_t snr, uint64_t start) {
+    if (model->op != SX1272_MODEL_RX) {
+        model->stats.rx_missed++;
+        return false;
+    }
+    if (model->rx_busy) {
+        // Same channel, same time: neither packet survives
+        model->rx_corrupt = true;
+        model->stats.rx_collisions++;
+        return false;
+    }
+
+    memcpy(model->rx_data, data, length);
+    model->rx_length = length;
+    model->rx_rssi = rssi;
+    model->rx_snr = snr;
+    model->rx_corrupt = false;
+    model->rx_busy = true;
+    model->done_at = start + (uint64_t)sx1272_model_airtime_us(model, length) * 1000;
+    return true;
+}
+
+uint64_t sx1272_model_next_event(const sx1272_model_t *model) {
+    if (model->op == SX1272_MODEL_TX || model->op == SX1272_MODEL_CAD ||
+        (model->op == SX1272_MODEL_RX && model->rx_busy)) {
+        return model->done_at;
+    }
+    return UINT64_MAX;
+}
+
+static void sx1272_model_rx_done(sx1272_model_t *model) {
+    uint8_t base = model->rx_ptr;
+    uint8_t length = model->rx_length;
+    uint8_t flags = IRQ_RX_DONE_MASK | IRQ_VALID_HEADER_MASK;
+    int16_t rssi = model->rx_rssi - SX1272_RSSI_OFFSET;
+
+    model->rx_busy = false;
+
+    // Implicit header: the receiver takes the configured length
+    if (model->regs[REG_MODEM_CONFIG1] & 0x04) length = model->regs[REG_PAYLOAD_LENGTH];
+    if (model->rx_corrupt || length > model->regs[REG_MAX_PAYLOAD_LENGTH]) flags |= IRQ_CRC_ERROR_MASK;
+
+    // In RX_CONT packets follow each other through the whole FIFO, over
+    // the TX region too, until RX is entered again
+    for (uint16_t i = 0; i < length; i++) {
+        model->fifo[(uint8_t)(base + i)] = model->rx_data[i];
+    }
+    model->rx_ptr = base + length;
+    model->regs[REG_FIFO_RX_CURRENT] = base;
+    model->regs[REG_RX_NB_BYTES] = length;
+    model->regs[REG_PKT_SNR_VALUE] = (uint8_t)(model->rx_snr * 4);
+    model->regs[REG_PKT_RSSI_VALUE] = rssi < 0 ? 0 : (rssi > 255 ? 255 : rssi);
+    model->regs[REG_FEI_MSB] = 0;
+    model->regs[REG_FEI_MSB + 1] = 0;
+    model->regs[REG_FEI_LSB] = 0;
+
+    if (!(flags & IRQ_CRC_ERROR_MASK)) model->stats.rx_frames++;
+    if ((model->regs[REG_OP_MODE] & MODE_MASK) == MODE_RX_SINGLE) sx1272_model_standby(model);
+    sx1272_model_raise(model, flags);
+}
+
+void sx1272_model_run(sx1272_model_t *model, uint64_t now) {
+    uint64_t due = sx1272_model_next_event(model);
+
+    if (due > now) return;
+    model->now = now;
+
+    switch (model->op) {
+    case SX1272_MODEL_TX: {
+        uint8_t frame[256];
+        uint8_t length = model->regs[REG_PAYLOAD_LENGTH];
+        uint8_t base = model->regs[REG_FIFO_TX_BASE_ADDR];
+
+        for (uint16_t i = 0; i < length; i++) frame[i] = model->fifo[(uint8_t)(base + i)];
+        model->stats.tx_frames++;
+        sx1272_model_standby(model);
+        if (model->on_tx != NULL) model->on_tx(model, frame, length);
+        sx1272_model_raise(model, IRQ_TX_DONE_MASK);
+        break;
+    }
+    case SX1272_MODEL_CAD:
+        sx1272_model_standby(model);
+        sx1272_model_raise(model, IRQ_CAD_DONE_MASK |
+                           ((model->carrier || model->rx_busy) ? IRQ_CAD_DETECTED_MASK : 0));
+        break;
+    case SX1272_MODEL_RX:
+        sx1272_model_rx_done(model);
+        break;
+    default:
+        break;
+    }
+}